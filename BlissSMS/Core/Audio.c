@@ -0,0 +1,167 @@
+#include "Audio.h"
+
+static sfBool audioGetData(sfSoundStreamChunk* data, void* user)
+{
+	struct Audio* audio = (struct Audio*)user;
+
+	u32 read = audio->read_count;
+	u32 available = atomicLoad(&audio->write_count) - read;
+	u32 count = (available < audio->chunk_size) ? available : audio->chunk_size;
+
+	u32 start = read & (audio->ring_size - 1);
+	u32 first = audio->ring_size - start;
+	if (first > count)
+		first = count;
+	memcpy(audio->chunk, &audio->ring[start], first * sizeof(s16));
+	memcpy(&audio->chunk[first], audio->ring, (count - first) * sizeof(s16));
+
+	if (count > 0)
+		audio->last_sample = audio->chunk[count - 1];
+	if (count < audio->chunk_size) {
+		for (u32 i = count; i < audio->chunk_size; i++)
+			audio->chunk[i] = audio->last_sample;
+		atomicStore(&audio->underruns, audio->underruns + 1);
+	}
+	atomicStore(&audio->read_count, read + count);
+
+	//returning false would stop the stream, an underrun plays the held sample instead
+	data->samples = audio->chunk;
+	data->sampleCount = audio->chunk_size;
+	return sfTrue;
+}
+
+static void audioSeek(sfTime offset, void* user)
+{
+	//a live stream has nowhere to seek to
+	(void)offset;
+	(void)user;
+}
+
+void audioInit(struct Audio* audio)
+{
+	audio->ring = NULL;
+	audio->ring_size = 0;
+	audio->write_count = 0;
+	audio->read_count = 0;
+	audio->chunk = NULL;
+	audio->chunk_size = 0;
+	audio->last_sample = 0;
+	audio->sample_rate = 0;
+	audio->latency_ms = 0;
+	audio->target_fill = 0;
+	audio->underruns = 0;
+	audio->overruns = 0;
+	audio->samples_dropped = 0;
+	audio->stream = NULL;
+	audio->playing = 0;
+}
+
+//Opens a mono stream at sample_rate that runs about latency_ms behind the emulation
+u8 audioStart(struct Audio* audio, u32 sample_rate, u32 latency_ms)
+{
+	if (audio->stream != NULL)
+		audioStop(audio);
+
+	audio->sample_rate = sample_rate;
+	audio->latency_ms = latency_ms;
+	audio->target_fill = (sample_rate * latency_ms) / 1000;
+
+	//the stream queues a few chunks of its own. Small chunks also drain the
+	//ring evenly, so frames paced by its fill come out evenly spaced
+	audio->chunk_size = audio->target_fill / 4;
+	if (audio->chunk_size < AUDIO_MIN_CHUNK)
+		audio->chunk_size = AUDIO_MIN_CHUNK;
+
+	//room for a few frames past the target before pushes are cut short
+	audio->ring_size = 1;
+	while (audio->ring_size < (audio->target_fill + audio->chunk_size) * 2)
+		audio->ring_size <<= 1;
+
+	audio->ring = (s16*)malloc(audio->ring_size * sizeof(s16));
+	audio->chunk = (s16*)malloc(audio->chunk_size * sizeof(s16));
+	audio->write_count = 0;
+	audio->read_count = 0;
+	audio->last_sample = 0;
+	audio->underruns = 0;
+	audio->overruns = 0;
+	audio->samples_dropped = 0;
+	if (audio->ring == NULL || audio->chunk == NULL) {
+		printf("Failed to allocate the audio buffers\n");
+		audioStop(audio);
+		return 0;
+	}
+
+	audio->stream = sfSoundStream_create(audioGetData, audioSeek, 1, sample_rate, audio);
+	if (audio->stream == NULL) {
+		printf("Failed to create the audio stream\n");
+		audioStop(audio);
+		return 0;
+	}
+	audio->playing = 0;
+	return 1;
+}
+
+void audioStop(struct Audio* audio)
+{
+	if (audio->stream != NULL) {
+		sfSoundStream_stop(audio->stream);
+		sfSoundStream_destroy(audio->stream);
+	}
+	audio->stream = NULL;
+	audio->playing = 0;
+
+	if (audio->ring != NULL)
+		free(audio->ring);
+	if (audio->chunk != NULL)
+		free(audio->chunk);
+	audio->ring = NULL;
+	audio->chunk = NULL;
+}
+
+//Queues samples for the stream, a frame goes in with one memcpy unless it
+//wraps the end of the ring. Returns how many fit, the rest are dropped
+u32 audioPush(struct Audio* audio, const s16* samples, u32 count)
+{
+	if (audio->stream == NULL)
+		return 0;
+
+	u32 write = audio->write_count;
+	u32 space = audio->ring_size - (write - atomicLoad(&audio->read_count));
+	if (count > space) {
+		audio->overruns++;
+		audio->samples_dropped += count - space;
+		count = space;
+	}
+
+	u32 start = write & (audio->ring_size - 1);
+	u32 first = audio->ring_size - start;
+	if (first >= count) {
+		memcpy(&audio->ring[start], samples, count * sizeof(s16));
+	}
+	else {
+		memcpy(&audio->ring[start], samples, first * sizeof(s16));
+		memcpy(audio->ring, &samples[first], (count - first) * sizeof(s16));
+	}
+	atomicStore(&audio->write_count, write + count);
+
+	//held back until there is enough queued to not underrun straight away
+	if (!audio->playing && (write + count) - audio->read_count >= audio->target_fill) {
+		sfSoundStream_play(audio->stream);
+		audio->playing = 1;
+	}
+
+	return count;
+}
+
+//Samples queued and not yet taken by the stream
+u32 audioFill(struct Audio* audio)
+{
+	return atomicLoad(&audio->write_count) - atomicLoad(&audio->read_count);
+}
+
+void audioPrintStats(struct Audio* audio)
+{
+	printf("Audio: %u/%u samples queued, %u underruns, %u overruns (%u samples dropped)\n",
+		audioFill(audio), audio->target_fill, atomicLoad(&audio->underruns),
+		audio->overruns, audio->samples_dropped);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Util.h"
+#include "SFML\Audio.h"
+
+//Plays the psg through an sfSoundStream. The emulation thread pushes each
+//frame's samples into a ring buffer and the stream's callback thread pulls
+//them out, the two only share the ring's read and write counts.
+
+#define AUDIO_DEFAULT_LATENCY_MS 60
+#define AUDIO_MIN_CHUNK 256 //smallest block handed to the stream in samples
+#define AUDIO_FRAME_SAMPLES 2048 //psg samples read per push, more than a frame makes at 48khz
+
+struct Audio {
+	//Single producer, single consumer ring of mono samples. The counts only
+	//ever increase and are masked into the ring, only the emulation thread
+	//moves write_count and only the stream thread moves read_count
+	s16* ring;
+	u32 ring_size; //power of 2
+	volatile u32 write_count;
+	volatile u32 read_count;
+
+	s16* chunk; //block being played, owned by the stream thread
+	u32 chunk_size;
+	s16 last_sample; //repeated to fill an underrun so it doesnt click
+
+	u32 sample_rate;
+	u32 latency_ms;
+	u32 target_fill; //samples queued for latency_ms of delay
+
+	volatile u32 underruns; //chunks the ring couldnt fill
+	u32 overruns; //pushes that didnt fit and were cut short
+	u32 samples_dropped;
+
+	sfSoundStream* stream;
+	u8 playing; //the stream starts once the ring first reaches target_fill
+};
+
+void audioInit(struct Audio* audio);
+u8 audioStart(struct Audio* audio, u32 sample_rate, u32 latency_ms);
+void audioStop(struct Audio* audio);
+u32 audioPush(struct Audio* audio, const s16* samples, u32 count);
+u32 audioFill(struct Audio* audio);
+void audioPrintStats(struct Audio* audio);
@@ -4,7 +4,6 @@
 
 void memoryBusInit(struct Bus* bus)
 {
-	memset(bus->memory, 0x0, 0xC000);
 	memset(bus->system_ram, 0x0, SYSRAM_SIZE);
 	memset(bus->bios, 0x0, BIOS_SIZE);
 
@@ -23,6 +22,10 @@ void memoryBusInit(struct Bus* bus)
 	bus->rom_bank0_register = 0;
 	bus->rom_bank1_register = 1;
 	bus->rom_bank2_register = 2;
+
+	bus->cart = NULL;
+	memset(bus->unmapped, 0x0, BUS_PAGE_SIZE);
+	memoryBusUpdatePages(bus);
 }
 
 void memoryBusLoadBios(struct Bus* bus, const char *path)
@@ -35,6 +38,8 @@ void memoryBusLoadBios(struct Bus* bus, const char *path)
 	bus->bios_enabled = 1;
 	fread(bus->bios, sizeof(u8), BIOS_SIZE, bios);
 	fclose(bios);
+
+	memoryBusUpdatePages(bus);
 }
 
 void memoryBusLoadCart(struct Bus* bus, struct Cart* cart)
@@ -42,36 +47,26 @@ void memoryBusLoadCart(struct Bus* bus, struct Cart* cart)
 	bus->cart = cart;
 	bus->cart_loaded = 1;
 
-	if (cart->romsize == CART_32K)
-		memcpy(bus->memory, cart->memory, 0x8000);
-	else
-		memcpy(bus->memory, cart->memory, 0xC000); //fill the full 48k rom space
+	//rom is read in place through the page tables
+	memoryBusUpdatePages(bus);
 }
 
 void memoryBusWriteU8(struct Bus* bus, u8 value, u16 address)
 {	
-	if (address < 0x8000) return;
+	u8* page = bus->write_pages[address >> BUS_PAGE_SHIFT];
+	if (page != NULL)
+		page[address & BUS_PAGE_MASK] = value;
 
-	if (address >= RAM_SLOT_2_START && address <= RAM_SLOT_2_END) {
-		if (bus->page2_ram == 1) { //page 2 mapped as cart ram
-			u32 ram_bank_addr = address + (0x4000 * bus->cart_ram_page);
-			ram_bank_addr -= 0x8000;
-			cartWriteU8(bus->cart, value, ram_bank_addr);
-		}
-	}
-
-	if (address >= SYSRAM_START && address <= SYSRAM_END) {
-		bus->system_ram[address & (SYSRAM_SIZE - 1)] = value;
-	}
-	//Mirrored system ram
-	else if (address >= 0xE000 && address <= 0xFFFF) {
-		bus->system_ram[address & (SYSRAM_SIZE - 1)] = value;
-	}
+	//Rom mapping registers, also written through to system ram above
+	if (address >= RAM_MAPPING_REGISTER)
+		memoryBusWriteMappingRegister(bus, value, address);
+}
 
-	//Rom mapping registers
+void memoryBusWriteMappingRegister(struct Bus* bus, u8 value, u16 address)
+{
 	if (address == 0xFFFC) { //ram/rom control
 		u8 b3 = testBit(value, 3);
-		if (b3) { //page 2 mapped as on board cart ram
+		if (b3 && cartAllocSram(bus->cart)) { //page 2 mapped as on board cart ram
 			bus->cart->banks_sram = 1;
 			bus->page2_ram = 1;
 			if (testBit(value, 2))
@@ -79,7 +74,7 @@ void memoryBusWriteU8(struct Bus* bus, u8 value, u16 address)
 			else
 				bus->cart_ram_page = 0; //use first page of cart ram
 		}
-		else { //page 2 mapped as rom
+		else if (!b3) { //page 2 mapped as rom
 			bus->page2_ram = 0;
 		}
 	}
@@ -95,6 +90,7 @@ void memoryBusWriteU8(struct Bus* bus, u8 value, u16 address)
 			bus->rom_bank2_register = value;
 		}
 	}
+	memoryBusUpdatePages(bus);
 }
 
 void writeMemoryControl(struct Bus* bus, u8 value)
@@ -103,78 +99,71 @@ void writeMemoryControl(struct Bus* bus, u8 value)
 	bus->wram_enabled = ((value >> 4) & 0x1) == 0;
 	bus->bios_enabled = ((value >> 3) & 0x1) == 0;
 	bus->io_enabled = ((value >> 2) & 0x1) == 0;
+
+	memoryBusUpdatePages(bus);
 }
 
 u8 memoryBusReadU8(struct Bus* bus, u16 address)
 {
-	if (address < BIOS_SIZE && bus->bios_enabled) {
-		return bus->bios[address & (BIOS_SIZE - 1)];
-	}
+	return bus->read_pages[address >> BUS_PAGE_SHIFT][address & BUS_PAGE_MASK];
+}
 
-	if (bus->cart_slot_enabled) {
-		if (!bus->cart_loaded)
-			return 0;
+static u8* memoryBusRomPage(struct Bus* bus, u32 bank_address)
+{
+	return &bus->cart->memory[bank_address & (bus->cart->romsize - 1)];
+}
 
-		if (address >= ROM_START && address <= ROM_END) {
-			return bus->memory[address];
+void memoryBusUpdatePages(struct Bus* bus)
+{
+	for (u32 page = 0; page < BUS_PAGE_COUNT; page++) {
+		u16 address = page << BUS_PAGE_SHIFT;
+		bus->read_pages[page] = bus->unmapped;
+		bus->write_pages[page] = NULL;
+
+		//System ram and its mirror
+		if (address >= SYSRAM_START) {
+			u8* ram = &bus->system_ram[address & (SYSRAM_SIZE - 1)];
+			bus->read_pages[page] = ram;
+			bus->write_pages[page] = ram;
 		}
 
-		if (bus->cart->romsize == CART_32K) {
-			if(address < 0x8000)
-				return bus->memory[address & 0x7FFF];
+		//Cart ram writes go through even when the slot is disabled
+		if (address >= RAM_SLOT_2_START && address <= RAM_SLOT_2_END && bus->page2_ram) {
+			u32 ram_bank_addr = (address - RAM_SLOT_2_START) + (0x4000 * bus->cart_ram_page);
+			bus->write_pages[page] = &bus->cart->ram_banks[ram_bank_addr & 0x7FFF];
 		}
-		else {
-			if (address >= ROM_SLOT_0_START && address <= ROM_SLOT_0_END) {
-				return memoryBusHandleRomMappingRead(bus, address, 0);
-			}
-			else if (address >= ROM_SLOT_1_START && address <= ROM_SLOT_1_END) {
-				return memoryBusHandleRomMappingRead(bus, address, 1);
-			}
-			else if (address >= RAM_SLOT_2_START && address <= RAM_SLOT_2_END) {
-				return memoryBusHandleRomMappingRead(bus, address, 2);
-			}
+
+		if (address < BIOS_SIZE && bus->bios_enabled) {
+			bus->read_pages[page] = &bus->bios[address];
+			continue;
 		}
-	}
-	
-	if (address >= SYSRAM_START && address <= SYSRAM_END) {
-		return bus->system_ram[address & (SYSRAM_SIZE - 1)];
-	}
 
-	//Mirrored system ram
-	else if (address >= 0xE000 && address <= 0xFFFF) {
-		return bus->system_ram[address & (SYSRAM_SIZE - 1)];
-	}
-}
+		if (!bus->cart_slot_enabled || !bus->cart_loaded || address >= SYSRAM_START)
+			continue;
 
-u8 memoryBusHandleRomMappingRead(struct Bus* bus, u16 address, u8 romBank)
-{
-	switch (romBank) {
-		case 0: {
+		if (address <= ROM_END) { //first 1k is never paged
+			bus->read_pages[page] = &bus->cart->memory[address];
+		}
+		else if (bus->cart->romsize == CART_32K) {
+			if (address < RAM_SLOT_2_START)
+				bus->read_pages[page] = &bus->cart->memory[address];
+			else if (bus->page2_ram)
+				bus->read_pages[page] = bus->write_pages[page];
+		}
+		else if (address <= ROM_SLOT_0_END) {
 			u32 bank_address = address + (0x4000 * bus->rom_bank0_register);
-			return cartReadU8(bus->cart, bank_address, 0);
+			bus->read_pages[page] = memoryBusRomPage(bus, bank_address);
 		}
-		break;
-		case 1: {
-			u32 bank_address = address + (0x4000 * bus->rom_bank1_register);
-			bank_address -= 0x4000; //get actual bank offset
-			return cartReadU8(bus->cart, bank_address, 0);
+		else if (address <= ROM_SLOT_1_END) {
+			u32 bank_address = (address - ROM_SLOT_1_START) + (0x4000 * bus->rom_bank1_register);
+			bus->read_pages[page] = memoryBusRomPage(bus, bank_address);
 		}
-		break;
-		case 2: {
-			if (bus->page2_ram == 1) { //cart ram mapped here
-				u32 ram_bank_addr = address + (0x4000 * bus->cart_ram_page);
-				ram_bank_addr -= 0x8000;
-				return cartReadU8(bus->cart, ram_bank_addr, 1);
-			}
-
-			u32 bank_address = address + (0x4000 * bus->rom_bank2_register);
-			bank_address -= 0x8000;
-			return cartReadU8(bus->cart, bank_address, 0);
+		else if (bus->page2_ram) { //cart ram mapped here
+			bus->read_pages[page] = bus->write_pages[page];
+		}
+		else {
+			u32 bank_address = (address - RAM_SLOT_2_START) + (0x4000 * bus->rom_bank2_register);
+			bus->read_pages[page] = memoryBusRomPage(bus, bank_address);
 		}
-		break;
-		default:
-			printf("Rom bank %d not yet implemented\n", romBank);
-			break;
 	}
 }
-
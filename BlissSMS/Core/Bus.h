@@ -43,8 +43,13 @@
 #define ROM_MAPPING_1 0xFFFE
 #define ROM_MAPPING_2 0xFFFF
 
+//Page tables, the 64k address space split into 1k pages
+#define BUS_PAGE_SHIFT 10
+#define BUS_PAGE_SIZE 0x400
+#define BUS_PAGE_MASK (BUS_PAGE_SIZE - 1)
+#define BUS_PAGE_COUNT 0x40
+
 struct Bus {
-	u8 memory[0xC000]; //0 - BFFF (rom - rom mapper 2)
 	u8 system_ram[SYSRAM_SIZE];
 	u8 bios[SYSRAM_SIZE];
 
@@ -63,6 +68,12 @@ struct Bus {
 
 	u8 cart_loaded;
 
+	//Where each page reads from and writes to, rebuilt by memoryBusUpdatePages
+	//when the memory control or mapping registers change. A NULL write page is read only
+	u8* read_pages[BUS_PAGE_COUNT];
+	u8* write_pages[BUS_PAGE_COUNT];
+	u8 unmapped[BUS_PAGE_SIZE]; //backs pages nothing is mapped to
+
 	struct Cart* cart;
 };
 
@@ -74,4 +85,5 @@ void memoryBusWriteU8(struct Bus* bus, u8 value, u16 address);
 void writeMemoryControl(struct Bus* bus, u8 value);
 u8 memoryBusReadU8(struct Bus* bus, u16 address);
 
-u8 memoryBusHandleRomMappingRead(struct Bus* bus, u16 address, u8 romBank);
\ No newline at end of file
+void memoryBusWriteMappingRegister(struct Bus* bus, u8 value, u16 address);
+void memoryBusUpdatePages(struct Bus* bus);
\ No newline at end of file
@@ -1,16 +1,45 @@
 #include "Cart.h"
+#include <time.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 void cartInit(struct Cart* cart)
 {
 	cart->memory = NULL;
+	cart->mapped = 0;
+	cart->map_handle = NULL;
+	cart->romsize = 0;
 	cart->uses_sram = 0;
 	cart->banks_sram = 0;
 	cart->sram_path = NULL;
-	memset(cart->ram_banks, 0x0, 0x8000);
+	cart->ram_banks = NULL;
+}
+
+u8 cartAllocSram(struct Cart* cart)
+{
+	if (cart->ram_banks != NULL)
+		return 1;
+
+	cart->ram_banks = (u8*)malloc(CART_SRAM_SIZE);
+	if (cart->ram_banks == NULL) {
+		printf("--Cartridge sram could not be allocated--\n");
+		return 0;
+	}
+	memset(cart->ram_banks, 0x0, CART_SRAM_SIZE);
+	return 1;
 }
 
 void cartLoad(struct Cart* cart, char* path)
 {
+	clock_t start = clock();
+
 	char* ext = ".sms";
 	s32 str_size = strlen(path) + strlen(ext) + 1;
 
@@ -20,38 +49,29 @@ void cartLoad(struct Cart* cart, char* path)
 		strcat(dest, path);
 		strcat(dest, ext);
 
-		FILE* rom = fopen(dest, "r");
-		if (rom == NULL) {
+		u32 file_size = 0;
+		cart->memory = cartOpenFile(dest, &file_size, &cart->map_handle, &cart->mapped);
+		free(dest);
+		if (cart->memory == NULL) {
 			printf("---Cartridge file: %s could not be found---\n", path);
 			return;
 		}
-		//Determine rom size
-		fseek(rom, 0, SEEK_END);
-		u32 file_size = ftell(rom);
-		fseek(rom, 0, SEEK_SET);
 
 		cart->romsize = file_size;
 		//32kb, 64kb, 128kb, 256kb
-		if (file_size == CART_32K || file_size == CART_64K
-			|| file_size == CART_128K || file_size == CART_256K
-			|| file_size == CART_512K) {
-			cart->memory = (u8*)malloc(file_size * sizeof(u8));
-		}
-		else {
+		if (file_size != CART_32K && file_size != CART_64K
+			&& file_size != CART_128K && file_size != CART_256K
+			&& file_size != CART_512K) {
 			printf("--Cartridge size: 0x%05X not supported!--\n", file_size);
+			cartCloseFile(cart->memory, file_size, cart->map_handle, cart->mapped);
+			cart->memory = NULL;
 			return;
 		}
 
-		if (cart->memory != NULL) {
-			fread(cart->memory, sizeof(u8), file_size, rom);
+		u16 header_start_offset = 0x7FF0;
 
-			u16 header_start_offset = 0x7FF0;
-
-			u8 region_size = cart->memory[header_start_offset + 0xF];
-			cart->region = (region_size >> 4) & 0xF;
-		}
-		fclose(rom);
-		free(dest);
+		u8 region_size = cart->memory[header_start_offset + 0xF];
+		cart->region = (region_size >> 4) & 0xF;
 
 		//does the cart use sram?
 		char* sav_ext = ".sav";
@@ -63,7 +83,10 @@ void cartLoad(struct Cart* cart, char* path)
 			strcat(dest, path);
 			strcat(dest, sav_ext);
 
-			FILE* sav = fopen(dest, "r");
+			void* sav_handle = NULL;
+			u8 sav_mapped = 0;
+			u32 sav_size = 0;
+			u8* sav = cartOpenFile(dest, &sav_size, &sav_handle, &sav_mapped);
 			if (sav != NULL) {
 				cart->sram_path = (u8*)malloc(str_size);
 				if (cart->sram_path != NULL)
@@ -72,31 +95,124 @@ void cartLoad(struct Cart* cart, char* path)
 				cart->uses_sram = 1;
 				printf("cart uses sram\n");
 
-				fseek(sav, 0, SEEK_END);
-				u16 file_size = ftell(sav);
-				fseek(sav, 0, SEEK_SET);
+				//sram is written to, so it is copied out of the file
+				u32 copy_size = sav_size;
+				if (copy_size > CART_SRAM_SIZE)
+					copy_size = CART_SRAM_SIZE;
+				if (cartAllocSram(cart))
+					memcpy(cart->ram_banks, sav, copy_size);
 
-				//load sram
-				fread(cart->ram_banks, sizeof(u8), file_size, sav);
-
-				fclose(sav);
+				cartCloseFile(sav, sav_size, sav_handle, sav_mapped);
 			}
 			free(dest);
 		}
+
+		double load_ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+		printf("Cartridge loaded in %.3f ms (%s)\n", load_ms, cart->mapped ? "mapped" : "copied");
+	}
+}
+
+//Maps a file read only so every emulator instance loading it
+//shares the same pages, returns NULL if it can't be mapped
+static u8* cartMapFile(const char* path, u32* size, void** handle)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, 
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0
+		|| file_size.QuadPart > 0xFFFFFFFF) {
+		CloseHandle(file);
+		return NULL;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return NULL;
+
+	u8* data = (u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		CloseHandle(mapping);
+		return NULL;
+	}
+	*size = (u32)file_size.QuadPart;
+	*handle = mapping;
+	return data;
+#else
+	s32 fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0 || st.st_size > 0xFFFFFFFF) {
+		close(fd);
+		return NULL;
 	}
+
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return NULL;
+
+	*size = (u32)st.st_size;
+	*handle = NULL;
+	return (u8*)data;
+#endif
 }
 
-void cartWriteU8(struct Cart* cart, u8 value, u32 address)
+//Fallback for files that can't be mapped, reads a private copy
+static u8* cartReadFile(const char* path, u32* size)
 {
-	cart->ram_banks[address & 0x7FFF] = value;
+	FILE* file = fopen(path, "rb");
+	if (file == NULL)
+		return NULL;
+
+	fseek(file, 0, SEEK_END);
+	u32 file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	//an empty file still counts as found
+	u8* data = (u8*)malloc((file_size > 0) ? file_size : 1);
+	if (data != NULL)
+		*size = fread(data, sizeof(u8), file_size, file);
+
+	fclose(file);
+	return data;
+}
+
+u8* cartOpenFile(const char* path, u32* size, void** handle, u8* mapped)
+{
+	*handle = NULL;
+	*mapped = 0;
+
+	u8* data = cartMapFile(path, size, handle);
+	if (data != NULL) {
+		*mapped = 1;
+		return data;
+	}
+	return cartReadFile(path, size);
 }
 
-u8 cartReadU8(struct Cart* cart, u32 address, u8 ram)
+void cartCloseFile(u8* data, u32 size, void* handle, u8 mapped)
 {
-	if (ram)
-		return cart->ram_banks[address & 0x7FFF];
+	if (data == NULL)
+		return;
 
-	return cart->memory[address & (cart->romsize - 1)];
+	if (!mapped) {
+		free(data);
+		return;
+	}
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)handle);
+#else
+	(void)handle; //munmap only needs the mapping
+	munmap(data, size);
+#endif
 }
 
 void cartDumpSram(struct Cart* cart)
@@ -104,13 +220,9 @@ void cartDumpSram(struct Cart* cart)
 	if (cart != NULL) {
 		if (cart->uses_sram && cart->banks_sram) {
 			//dump sram to disk
-			FILE* sav = fopen(cart->sram_path, "w");
+			FILE* sav = fopen(cart->sram_path, "wb");
 			if (sav != NULL) {
-				fseek(sav, 0, SEEK_END);
-				u16 file_size = ftell(sav);
-				fseek(sav, 0, SEEK_SET);
-
-				fwrite(cart->ram_banks, sizeof(u8), file_size, sav);
+				fwrite(cart->ram_banks, sizeof(u8), CART_SRAM_SIZE, sav);
 				fclose(sav);
 			}
 			if (cart->sram_path != NULL)
@@ -122,7 +234,9 @@ void cartDumpSram(struct Cart* cart)
 void cartFree(struct Cart* cart)
 {
 	if (cart != NULL) {
-		if (cart->memory != NULL)
-			free(cart->memory);
+		cartCloseFile(cart->memory, cart->romsize, cart->map_handle, cart->mapped);
+		cart->memory = NULL;
+		if (cart->ram_banks != NULL)
+			free(cart->ram_banks);
 	}
 }
@@ -7,9 +7,13 @@
 #define CART_256K 0x40000
 #define CART_512K 0x80000
 
+#define CART_SRAM_SIZE 0x8000
+
 struct Cart {
-	u8* memory;
-	u8 ram_banks[0x8000]; //on board cartridge ram (sram)
+	u8* memory; //read only, mapped from the rom file when the platform allows
+	u8 mapped;
+	void* map_handle;
+	u8* ram_banks; //on board cartridge ram (sram), allocated once the cart uses it
 	u8 region;
 	u32 romsize;
 
@@ -20,9 +24,9 @@ struct Cart {
 
 void cartInit(struct Cart* cart);
 void cartLoad(struct Cart* cart, char* path);
-
-void cartWriteU8(struct Cart* cart, u8 value, u32 address);
-u8 cartReadU8(struct Cart* cart, u32 address, u8 ram);
+u8 cartAllocSram(struct Cart* cart);
+u8* cartOpenFile(const char* path, u32* size, void** handle, u8* mapped);
+void cartCloseFile(u8* data, u32 size, void* handle, u8 mapped);
 
 void cartDumpSram(struct Cart* cart);
 void cartFree(struct Cart* cart);
\ No newline at end of file
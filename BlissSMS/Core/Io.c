@@ -8,6 +8,7 @@ void ioInit(struct Io* io)
 {
 	io->vdp = NULL;
 	io->bus = NULL;
+	io->irq_line_changed = 0;
 }
 
 void ioConnectVdp(struct Io* io, struct Vdp* vdp)
@@ -56,9 +57,32 @@ void ioWriteU8(struct Io* io, u8 value, u8 address)
 	else if (address >= 0x80 && address <= 0xBF) {
 		if (even_address)
 			vdpWriteDataPort(io->vdp, value);
-		else
+		else {
 			vdpWriteControlPort(io->vdp, value);
+			io->irq_line_changed = 1;
+		}
+	}
+}
+
+//Writes values to a port as repeated ioWriteU8 calls would, returns how many
+//were written before a write could have changed the interrupt state or the
+//memory map, the caller has to read the rest again after that
+u16 ioWriteBlock(struct Io* io, const u8* values, u16 count, u8 address)
+{
+	u8 even_address = ((address & 0x1) == 0);
+	if (address >= 0x80 && address <= 0xBF && even_address) {
+		vdpWriteDataPortBulk(io->vdp, values, count);
+		return count;
+	}
+
+	//memory control can page out the bytes still to be written
+	u8 memory_control = (address <= 0x3F) && even_address;
+	for (u16 i = 0; i < count; i++) {
+		ioWriteU8(io, values[i], address);
+		if (io->irq_line_changed || memory_control)
+			return i + 1;
 	}
+	return count;
 }
 
 u8 ioReadU8(struct Io* io, u8 address)
@@ -3,6 +3,7 @@
 
 struct Io {
 	u8 nationalization_port;
+	u8 irq_line_changed; //vdp control writes can enable a pending interrupt
 
 	struct Vdp* vdp;
 	struct Psg* psg;
@@ -16,6 +17,7 @@ void ioConnectPsg(struct Io* io, struct Psg* psg);
 void ioConnectJoypad(struct Io* io, struct Joypad* joy);
 void ioConnectBus(struct Io* io, struct Bus* bus);
 void ioWriteU8(struct Io *io, u8 value, u8 address);
+u16 ioWriteBlock(struct Io* io, const u8* values, u16 count, u8 address);
 u8 ioReadU8(struct Io* io, u8 address);
 
 void ioResetButtonPressed(struct Io* io, u8 pressed);
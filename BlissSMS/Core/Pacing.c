@@ -0,0 +1,173 @@
+#include "Pacing.h"
+
+static sfInt64 pacingNow(struct Pacing* pacing)
+{
+	return sfTime_asMicroseconds(sfClock_getElapsedTime(pacing->clock));
+}
+
+static void pacingResetWindow(struct PacingWindow* window)
+{
+	window->frames = 0;
+	window->frame_us_min = 0;
+	window->frame_us_max = 0;
+	window->frame_us_total = 0;
+	window->fill_min = 0;
+	window->fill_max = 0;
+	window->fill_total = 0;
+}
+
+void pacingInit(struct Pacing* pacing, enum PacingMode mode, sfRenderWindow* window, struct System* sys)
+{
+	if (mode == PaceAudio && sys->audio.stream == NULL) {
+		printf("No audio to pace by, falling back to the timer\n");
+		mode = PaceTimer;
+	}
+	pacing->mode = mode;
+
+	//the framerate limiter is replaced by the pacing below
+	sfRenderWindow_setFramerateLimit(window, 0);
+	sfRenderWindow_setVerticalSyncEnabled(window, mode == PaceVsync);
+
+	pacing->clock = sfClock_create();
+	pacing->frame_us = (sfInt64)(1000000.0 / FRAME_RATE);
+	pacing->last_frame = pacingNow(pacing);
+	pacing->next_deadline = pacing->last_frame + pacing->frame_us;
+
+	pacing->average_fill = sys->audio.target_fill;
+	pacing->rate_ratio = 1.0;
+
+	pacingResetWindow(&pacing->window);
+	pacingResetWindow(&pacing->last_window);
+	pacing->last_underruns = 0;
+}
+
+void pacingFree(struct Pacing* pacing)
+{
+	if (pacing->clock != NULL)
+		sfClock_destroy(pacing->clock);
+	pacing->clock = NULL;
+}
+
+//Call once the frame's samples are in the audio ring. Waits until the next
+//frame is due and returns 1 when a telemetry window has just been filled
+u8 pacingEndFrame(struct Pacing* pacing, struct System* sys)
+{
+	u32 fill = 0;
+	if (sys->audio.stream != NULL) {
+		fill = audioFill(&sys->audio);
+		//when the audio sets the pace it already holds the fill at its target
+		if (pacing->mode != PaceAudio)
+			pacingUpdateRate(pacing, sys);
+	}
+
+	if (pacing->mode == PaceAudio)
+		pacingWaitForAudio(pacing, sys);
+	else if (pacing->mode == PaceTimer)
+		pacingWaitForDeadline(pacing);
+	//vsync mode waits in sfRenderWindow_display
+
+	sfInt64 now = pacingNow(pacing);
+	sfInt64 frame_us = now - pacing->last_frame;
+	pacing->last_frame = now;
+
+	pacingRecordFrame(pacing, frame_us, fill);
+	if (pacing->window.frames < PACING_WINDOW_FRAMES)
+		return 0;
+
+	pacing->last_window = pacing->window;
+	pacingResetWindow(&pacing->window);
+	return 1;
+}
+
+//Nudges the psg's sample rate so the ring's average fill settles on its target,
+//a ring running low gets more samples per frame and a full one gets fewer
+void pacingUpdateRate(struct Pacing* pacing, struct System* sys)
+{
+	struct Audio* audio = &sys->audio;
+	if (audio->target_fill == 0)
+		return;
+
+	pacing->average_fill += ((double)audioFill(audio) - pacing->average_fill) / PACING_FILL_SMOOTHING;
+
+	double error = ((double)audio->target_fill - pacing->average_fill) / audio->target_fill;
+	if (error > 1.0) error = 1.0;
+	if (error < -1.0) error = -1.0;
+
+	pacing->rate_ratio = 1.0 + (error * PACING_MAX_RATE_DELTA);
+	psgSetRateRatio(&sys->psg, pacing->rate_ratio);
+}
+
+//Holds the emulation back while the ring has more than its target queued
+void pacingWaitForAudio(struct Pacing* pacing, struct System* sys)
+{
+	struct Audio* audio = &sys->audio;
+
+	sfInt64 give_up = pacingNow(pacing) + (PACING_AUDIO_TIMEOUT_MS * 1000);
+	while (audioFill(audio) > audio->target_fill) {
+		if (pacingNow(pacing) > give_up)
+			break;
+		sfSleep(sfMilliseconds(1));
+	}
+}
+
+//Sleeps most of the way to the deadline and spins the rest, sleeps alone
+//can overshoot by a whole scheduler tick
+void pacingWaitForDeadline(struct Pacing* pacing)
+{
+	sfInt64 now = pacingNow(pacing);
+
+	//too far behind to catch up, start again from now rather than racing
+	if (now - pacing->next_deadline > pacing->frame_us) {
+		pacing->next_deadline = now + pacing->frame_us;
+		return;
+	}
+
+	sfInt64 remaining = pacing->next_deadline - now;
+	if (remaining > PACING_SPIN_US)
+		sfSleep(sfMicroseconds(remaining - PACING_SPIN_US));
+	while (pacingNow(pacing) < pacing->next_deadline);
+
+	pacing->next_deadline += pacing->frame_us;
+}
+
+void pacingRecordFrame(struct Pacing* pacing, sfInt64 frame_us, u32 fill)
+{
+	struct PacingWindow* window = &pacing->window;
+	if (window->frames == 0) {
+		window->frame_us_min = frame_us;
+		window->frame_us_max = frame_us;
+		window->fill_min = fill;
+		window->fill_max = fill;
+	}
+
+	if (frame_us < window->frame_us_min) window->frame_us_min = frame_us;
+	if (frame_us > window->frame_us_max) window->frame_us_max = frame_us;
+	if (fill < window->fill_min) window->fill_min = fill;
+	if (fill > window->fill_max) window->fill_max = fill;
+	window->frame_us_total += frame_us;
+	window->fill_total += fill;
+	window->frames++;
+}
+
+void pacingPrintStats(struct Pacing* pacing, struct System* sys)
+{
+	static const char* modes[] = { "audio", "vsync", "timer" };
+
+	struct PacingWindow* window = &pacing->last_window;
+	if (window->frames == 0)
+		return;
+
+	printf("Pacing (%s): frame %.2f/%.2f/%.2f ms min/avg/max, target %.2f ms\n",
+		modes[pacing->mode], window->frame_us_min / 1000.0,
+		(window->frame_us_total / 1000.0) / window->frames, window->frame_us_max / 1000.0,
+		pacing->frame_us / 1000.0);
+
+	if (sys->audio.stream == NULL)
+		return;
+
+	u32 underruns = atomicLoad(&sys->audio.underruns);
+	printf("Pacing: fill %u/%llu/%u samples min/avg/max, target %u, rate %.4f, %u underruns\n",
+		window->fill_min, window->fill_total / window->frames, window->fill_max,
+		sys->audio.target_fill, pacing->rate_ratio, underruns - pacing->last_underruns);
+	pacing->last_underruns = underruns;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "System.h"
+
+//Keeps the emulation at the speed of the real console. In audio mode the
+//emulation waits while the audio ring is over its target fill, in vsync
+//mode the display's refresh holds it back and in timer mode it waits for
+//each frame's deadline at the console's 59.92hz. When vsync or the timer
+//set the pace, the psg's sample rate is nudged by the ring's fill so the
+//audio drifts back to its target instead of crackling or building up delay.
+enum PacingMode {
+	PaceAudio,
+	PaceVsync,
+	PaceTimer
+};
+
+#define PACING_MAX_RATE_DELTA 0.005 //rate control moves the pitch by at most half a percent
+#define PACING_FILL_SMOOTHING 16 //frames the ring's fill is averaged over
+#define PACING_AUDIO_TIMEOUT_MS 100 //stops waiting on a stream that has stalled
+#define PACING_SPIN_US 1500 //timer mode sleeps until this close to the deadline then spins
+#define PACING_WINDOW_FRAMES 60 //frames in each telemetry window
+
+struct PacingWindow {
+	u32 frames;
+	sfInt64 frame_us_min;
+	sfInt64 frame_us_max;
+	sfInt64 frame_us_total;
+	u32 fill_min;
+	u32 fill_max;
+	u64 fill_total;
+};
+
+struct Pacing {
+	enum PacingMode mode;
+	sfClock* clock;
+	sfInt64 frame_us; //length of an emulated frame on the host
+	sfInt64 last_frame; //time the last frame ended
+	sfInt64 next_deadline; //when the next frame is due in timer mode
+
+	double average_fill;
+	double rate_ratio;
+
+	//telemetry being gathered and the last full window
+	struct PacingWindow window;
+	struct PacingWindow last_window;
+	u32 last_underruns;
+};
+
+void pacingInit(struct Pacing* pacing, enum PacingMode mode, sfRenderWindow* window, struct System* sys);
+void pacingFree(struct Pacing* pacing);
+u8 pacingEndFrame(struct Pacing* pacing, struct System* sys);
+void pacingUpdateRate(struct Pacing* pacing, struct System* sys);
+void pacingWaitForAudio(struct Pacing* pacing, struct System* sys);
+void pacingWaitForDeadline(struct Pacing* pacing);
+void pacingRecordFrame(struct Pacing* pacing, sfInt64 frame_us, u32 fill);
+void pacingPrintStats(struct Pacing* pacing, struct System* sys);
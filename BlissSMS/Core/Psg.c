@@ -1,4 +1,138 @@
 #include "Psg.h"
+#include "System.h"
+#include <math.h>
+#include <time.h>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+#ifdef SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+//Band limited step for each quality and sub sample phase, every phase sums to
+//1 << PSG_BLEP_BITS so a step of any size settles at exactly that level
+static s32 psgBlepKernel[PsgQualityCount][PSG_BLEP_PHASES][PSG_BLEP_MAX_WIDTH];
+
+//linear is padded to 4 taps so every width suits the simd loops
+static const u32 psgQualityWidth[PsgQualityCount] = { 4, 16, 64 };
+
+//Adds delta times the kernel's width taps to the delta buffer, the fastest
+//version the host supports is picked the first time a psg is initialised
+static void (*psgAddStep)(s32* deltas, const s32* kernel, s32 delta, u32 width);
+static enum SimdType psgStepKernelType;
+
+static void psgBuildKernel(enum PsgQuality quality)
+{
+	const double pi = 3.14159265358979323846;
+	const double cutoff = 0.9; //of the host nyquist rate, leaves room for the window rolloff
+	u32 width = psgQualityWidth[quality];
+
+	for (u32 phase = 0; phase < PSG_BLEP_PHASES; phase++) {
+		double taps[PSG_BLEP_MAX_WIDTH];
+		double sum = 0;
+		for (u32 i = 0; i < width; i++) {
+			//distance in samples from the step, which lands between the middle two taps
+			double x = (double)i - ((width / 2) - 1) - ((double)phase / PSG_BLEP_PHASES);
+			if (quality == PsgQualityLinear) {
+				taps[i] = (fabs(x) < 1.0) ? 1.0 - fabs(x) : 0.0;
+			}
+			else {
+				double sinc = (x == 0) ? cutoff : sin(pi * cutoff * x) / (pi * x);
+				double window = 0.42 + 0.5 * cos(2 * pi * x / width)
+					+ 0.08 * cos(4 * pi * x / width); //blackman
+				taps[i] = sinc * window;
+			}
+			sum += taps[i];
+		}
+
+		//rounding error goes on the largest tap
+		s32* kernel = psgBlepKernel[quality][phase];
+		s32 total = 0;
+		u32 largest = 0;
+		for (u32 i = 0; i < width; i++) {
+			kernel[i] = (s32)floor((taps[i] / sum) * (1 << PSG_BLEP_BITS) + 0.5);
+			total += kernel[i];
+			if (kernel[i] > kernel[largest])
+				largest = i;
+		}
+		kernel[largest] += (1 << PSG_BLEP_BITS) - total;
+	}
+}
+
+static void psgAddStepScalar(s32* deltas, const s32* kernel, s32 delta, u32 width)
+{
+	for (u32 i = 0; i < width; i++)
+		deltas[i] += delta * kernel[i];
+}
+
+#ifdef SIMD_X86
+
+//Taps and deltas both fit in 16 bits, so madd can multiply the low half of
+//each lane. The delta's high half is 0 which drops the taps' sign extension
+SIMD_TARGET("sse2") static void psgAddStepSse2(s32* deltas, const s32* kernel, s32 delta, u32 width)
+{
+	const __m128i scale = _mm_set1_epi32(delta & 0xFFFF);
+	for (u32 i = 0; i < width; i += 4) {
+		__m128i sum = _mm_loadu_si128((const __m128i*)&deltas[i]);
+		__m128i taps = _mm_loadu_si128((const __m128i*)&kernel[i]);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(taps, scale));
+		_mm_storeu_si128((__m128i*)&deltas[i], sum);
+	}
+}
+
+SIMD_TARGET("avx2") static void psgAddStepAvx2(s32* deltas, const s32* kernel, s32 delta, u32 width)
+{
+	const __m256i scale = _mm256_set1_epi32(delta & 0xFFFF);
+	u32 i = 0;
+	for (; i + 8 <= width; i += 8) {
+		__m256i sum = _mm256_loadu_si256((const __m256i*)&deltas[i]);
+		__m256i taps = _mm256_loadu_si256((const __m256i*)&kernel[i]);
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(taps, scale));
+		_mm256_storeu_si256((__m256i*)&deltas[i], sum);
+	}
+	//the linear kernel's 4 taps
+	if (i < width) {
+		__m128i sum = _mm_loadu_si128((const __m128i*)&deltas[i]);
+		__m128i taps = _mm_loadu_si128((const __m128i*)&kernel[i]);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(taps, _mm256_castsi256_si128(scale)));
+		_mm_storeu_si128((__m128i*)&deltas[i], sum);
+	}
+}
+
+#endif
+
+#ifdef SIMD_NEON
+
+static void psgAddStepNeon(s32* deltas, const s32* kernel, s32 delta, u32 width)
+{
+	for (u32 i = 0; i < width; i += 4)
+		vst1q_s32(&deltas[i], vmlaq_n_s32(vld1q_s32(&deltas[i]), vld1q_s32(&kernel[i]), delta));
+}
+
+#endif
+
+//Uses the step loop for the given instruction set
+u8 psgSelectStepKernel(enum SimdType type)
+{
+	if (!simdSupported(type))
+		return 0;
+
+	switch (type) {
+		case SimdScalar: psgAddStep = psgAddStepScalar; break;
+#ifdef SIMD_X86
+		case SimdSse2: psgAddStep = psgAddStepSse2; break;
+		case SimdAvx2: psgAddStep = psgAddStepAvx2; break;
+#endif
+#ifdef SIMD_NEON
+		case SimdNeon: psgAddStep = psgAddStepNeon; break;
+#endif
+		default: return 0;
+	}
+	psgStepKernelType = type;
+	return 1;
+}
 
 void psgInit(struct Psg* psg)
 {
@@ -11,20 +145,297 @@ void psgInit(struct Psg* psg)
 		curr_volume *= two_decibels; //next vol is lower by 2 decibels
 	}
 	psg->volume_table[0xF] = 0; //0b1111 is off
+
+	if (psgAddStep == NULL) {
+		for (u8 quality = 0; quality < PsgQualityCount; quality++)
+			psgBuildKernel(quality);
+		for (s32 type = SimdCount - 1; type >= SimdScalar; type--) {
+			if (psgSelectStepKernel(type))
+				break;
+		}
+	}
+	psgSetQuality(psg, PsgQualityMedium);
+
+	psg->latched_type = 0;
+	psg->latched_channel = 0;
+	for (u8 channel = 0; channel < 4; channel++) {
+		psg->tones[channel] = 0;
+		psg->volume[channel] = 0xF;
+		psg->channels[channel].counter = 1;
+		psg->channels[channel].output = 0;
+		psg->channels[channel].amplitude = 0;
+	}
+	psg->lfsr = 0x8000;
+	psg->clock_remainder = 0;
+
+	psg->write_count = 0;
+	psg->write_log_overflow = 0;
+	psg->log_start = 0;
+	psg->log_cycles = 0;
+	psg->synthesized_writes = 0;
+	psg->synthesized_cycles = 0;
+	psg->z80 = NULL;
+
+	psg->deltas = NULL;
+	psgSetSampleRate(psg, PSG_DEFAULT_SAMPLE_RATE);
+}
+
+void psgFree(struct Psg* psg)
+{
+	if (psg->deltas != NULL)
+		free(psg->deltas);
+	psg->deltas = NULL;
+}
+
+void psgConnectZ80(struct Psg* psg, struct Z80* z80)
+{
+	psg->z80 = z80;
+}
+
+//Starts a new delta buffer for the host rate, samples not yet read are dropped
+void psgSetSampleRate(struct Psg* psg, u32 sample_rate)
+{
+	double psg_clock = (double)CPU_CLOCK / PSG_CLOCK_DIVIDER;
+	psg->sample_rate = sample_rate;
+	psg->nominal_clock_step = (u64)(((double)sample_rate / psg_clock) * 4294967296.0);
+	psg->clock_step = psg->nominal_clock_step;
+
+	if (psg->deltas != NULL)
+		free(psg->deltas);
+	psg->buffer_size = (sample_rate * PSG_BUFFER_MS) / 1000;
+	psg->deltas = (s32*)calloc(psg->buffer_size + PSG_BLEP_MAX_WIDTH, sizeof(s32));
+	if (psg->deltas == NULL)
+		printf("Psg delta buffer failed to allocate\n");
+	psg->buffer_time = 0;
+
+	//carry on from the level the channels are at
+	psg->integrator = 0;
+	for (u8 channel = 0; channel < 4; channel++)
+		psg->integrator += psg->channels[channel].amplitude << PSG_BLEP_BITS;
+}
+
+//Steps already in the buffer keep the taps they were added with
+void psgSetQuality(struct Psg* psg, enum PsgQuality quality)
+{
+	psg->quality = quality;
+	psg->step_width = psgQualityWidth[quality];
+}
+
+//Makes ratio times as many samples per psg clock, for keeping the host's
+//audio buffer level while the emulation runs a little fast or slow
+void psgSetRateRatio(struct Psg* psg, double ratio)
+{
+	psg->clock_step = (u64)((double)psg->nominal_clock_step * ratio);
+}
+
+//Only moves the log's clock on, nothing is synthesized until psgSynthesize
+void psgUpdate(struct Psg* psg, u16 cycles)
+{
+	psg->log_cycles += cycles;
+}
+
+//Starts a new log, anything the last one hasnt synthesized yet is played first
+void psgBeginFrame(struct Psg* psg)
+{
+	psgSynthesize(psg);
+
+	psg->log_start += psg->log_cycles;
+	psg->log_cycles = 0;
+	psg->write_count = 0;
+	psg->write_log_overflow = 0;
+	psg->synthesized_writes = 0;
+	psg->synthesized_cycles = 0;
+}
+
+//Plays the logged writes at their cycles up to the end of the log, picking
+//up from where the last call stopped
+void psgSynthesize(struct Psg* psg)
+{
+	psgSynthesizeUntil(psg, psg->log_cycles);
 }
 
-void psgUpdate(struct Psg* psg, u8 cycles)
+//Same as psgSynthesize but stops at cycle, which can be past log_cycles for
+//writes made partway through a z80Run batch
+void psgSynthesizeUntil(struct Psg* psg, u32 cycle)
 {
-	
+	for (u32 i = psg->synthesized_writes; i < psg->write_count; i++) {
+		const struct PsgWrite* write = &psg->write_log[i];
+		if (write->cycle > psg->synthesized_cycles) {
+			psgAdvance(psg, write->cycle - psg->synthesized_cycles);
+			psg->synthesized_cycles = write->cycle;
+		}
+		psgApplyWrite(psg, write->value);
+	}
+	psg->synthesized_writes = psg->write_count;
+
+	//already synthesized up to a write later in the batch
+	if (cycle <= psg->synthesized_cycles)
+		return;
+	psgAdvance(psg, cycle - psg->synthesized_cycles);
+	psg->synthesized_cycles = cycle;
+}
+
+void psgAdvance(struct Psg* psg, u32 cycles)
+{
+	u32 total = psg->clock_remainder + cycles;
+	u32 clocks = total / PSG_CLOCK_DIVIDER;
+	psg->clock_remainder = total % PSG_CLOCK_DIVIDER;
+
+	if (psg->deltas == NULL)
+		return;
+
+	//a frame of clocks can be more than the buffer has room for, so it is
+	//run in pieces of up to half the buffer
+	u32 max_clocks = (u32)(((u64)(psg->buffer_size / 2) << 32) / psg->clock_step);
+	while (clocks > 0) {
+		u32 run = (clocks < max_clocks) ? clocks : max_clocks;
+
+		//samples nobody read are dropped to make room
+		u64 end = psg->buffer_time + ((u64)run * psg->clock_step);
+		if ((end >> 32) + 1 >= psg->buffer_size)
+			psgReadSamples(psg, NULL, psgSamplesAvailable(psg));
+
+		psgRun(psg, run);
+		clocks -= run;
+	}
+}
+
+//Steps every channel to its next output flip until clocks have passed,
+//only the flips reach the delta buffer
+void psgRun(struct Psg* psg, u32 clocks)
+{
+	for (u8 channel = 0; channel < 4; channel++) {
+		struct PsgChannel* c = &psg->channels[channel];
+		u16 period = psgChannelPeriod(psg, channel);
+		if (period == 0)
+			continue;
+
+		u32 elapsed = 0;
+		while (c->counter <= clocks - elapsed) {
+			elapsed += c->counter;
+			c->counter = period;
+			c->output ^= 1;
+
+			//the shift register moves on each rising edge of the noise counter
+			if (channel == PSG_NOISE_CHANNEL && c->output) {
+				u8 white_noise = (psg->tones[PSG_NOISE_CHANNEL] >> 2) & 0x1;
+				u16 feedback = psg->lfsr & 0x1; //periodic noise feeds bit 0 back in
+				if (white_noise)
+					feedback ^= (psg->lfsr >> 3) & 0x1; //white noise taps bits 0 and 3
+				psg->lfsr = (psg->lfsr >> 1) | (feedback << 15);
+			}
+			psgUpdateAmplitude(psg, channel, psg->buffer_time + ((u64)elapsed * psg->clock_step));
+		}
+		c->counter -= clocks - elapsed;
+	}
+	psg->buffer_time += (u64)clocks * psg->clock_step;
+}
+
+//Delta is the change in a channel's amplitude, it always fits in 16 bits
+void psgAddDelta(struct Psg* psg, u64 time, s32 delta)
+{
+	u32 position = (u32)(time >> 32);
+	u32 phase = (u32)((time & 0xFFFFFFFF) * PSG_BLEP_PHASES >> 32);
+
+	psgAddStep(&psg->deltas[position], psgBlepKernel[psg->quality][phase], delta, psg->step_width);
+}
+
+//Adds a step if the channel's level has changed
+void psgUpdateAmplitude(struct Psg* psg, u8 channel, u64 time)
+{
+	struct PsgChannel* c = &psg->channels[channel];
+
+	u8 level = c->output;
+	if (channel == PSG_NOISE_CHANNEL)
+		level = psg->lfsr & 0x1;
+	else if (psgChannelPeriod(psg, channel) == 0)
+		level = 1;
+
+	s32 volume = psg->volume_table[psg->volume[channel]];
+	s32 amplitude = level ? volume : -volume;
+	if (amplitude != c->amplitude) {
+		if (psg->deltas != NULL)
+			psgAddDelta(psg, time, amplitude - c->amplitude);
+		c->amplitude = amplitude;
+	}
+}
+
+//Psg clocks between output flips, 0 if the channel holds its output.
+//Tones of 0 and 1 stay high so games can play samples through the volume
+u16 psgChannelPeriod(struct Psg* psg, u8 channel)
+{
+	if (channel != PSG_NOISE_CHANNEL)
+		return (psg->tones[channel] <= 1) ? 0 : psg->tones[channel];
+
+	switch (psg->tones[PSG_NOISE_CHANNEL] & 0x3) {
+		case 0: return 0x10;
+		case 1: return 0x20;
+		case 2: return 0x40;
+		default: return (psg->tones[2] == 0) ? 0x400 : psg->tones[2]; //runs at tone 2's rate
+	}
+}
+
+u32 psgSamplesAvailable(struct Psg* psg)
+{
+	return (u32)(psg->buffer_time >> 32);
 }
 
+//Reads finished samples as 16 bit pcm, samples can be NULL to drop them
+u32 psgReadSamples(struct Psg* psg, s16* samples, u32 count)
+{
+	u32 available = psgSamplesAvailable(psg);
+	if (count > available)
+		count = available;
+
+	s32 sum = psg->integrator;
+	for (u32 i = 0; i < count; i++) {
+		sum += psg->deltas[i];
+		if (samples != NULL) {
+			s32 sample = sum >> PSG_BLEP_BITS;
+			if (sample > 32767) sample = 32767;
+			if (sample < -32768) sample = -32768;
+			samples[i] = (s16)sample;
+		}
+	}
+	psg->integrator = sum;
+
+	//move the samples still being built to the front
+	u32 used = available + PSG_BLEP_MAX_WIDTH;
+	memmove(psg->deltas, &psg->deltas[count], (used - count) * sizeof(s32));
+	memset(&psg->deltas[used - count], 0, count * sizeof(s32));
+	psg->buffer_time -= (u64)count << 32;
+
+	return count;
+}
+
+//Logs the write at the cycle the cpu made it, writes take effect when synthesized
 void psgWritePort(struct Psg* psg, u8 value)
 {
-	psg->latched_channel = ((value >> 5) & 0x3);
-	psg->latched_type = ((value >> 4) & 0x1);
+	u32 cycle = psg->log_cycles;
+	if (psg->z80 != NULL)
+		cycle += psg->z80->run_cycles;
+
+	//the batch this write is in hasnt reached log_cycles yet, so only
+	//synthesize up to the write
+	if (psg->write_count == PSG_LOG_SIZE) {
+		psgSynthesizeUntil(psg, cycle);
+		psg->write_count = 0;
+		psg->synthesized_writes = 0;
+		psg->write_log_overflow = 1;
+	}
 
+	struct PsgWrite* write = &psg->write_log[psg->write_count++];
+	write->cycle = cycle;
+	write->value = value;
+}
+
+void psgApplyWrite(struct Psg* psg, u8 value)
+{
 	//Latch register write
 	if ((value >> 7) & 0x1) {
+		psg->latched_channel = ((value >> 5) & 0x3);
+		psg->latched_type = ((value >> 4) & 0x1);
+
 		//Set channels volume
 		if (psg->latched_type) {
 			u8 vol = value & 0xF;
@@ -34,11 +445,14 @@ void psgWritePort(struct Psg* psg, u8 value)
 		else {
 			switch (psg->latched_channel) {
 			case 0: case 1: case 2: //pulse tones
-				psg->tone[psg->latched_channel] &= ~0xF; //clear lower nibble (frequency)
-				psg->tone[psg->latched_channel] |= (value & 0xF);
+				psg->tones[psg->latched_channel] &= ~0xF; //clear lower nibble (frequency)
+				psg->tones[psg->latched_channel] |= (value & 0xF);
 				break;
 
-			case 3: break; //noise channel
+			case 3: //noise channel, shift register is reset on writes
+				psg->tones[PSG_NOISE_CHANNEL] = value & 0x7;
+				psg->lfsr = 0x8000;
+				break;
 			}
 		}
 	}
@@ -52,12 +466,84 @@ void psgWritePort(struct Psg* psg, u8 value)
 		else {
 			switch (psg->latched_channel) {
 			case 0: case 1: case 2:
-				psg->tone[psg->latched_channel] &= 0xF;
-				psg->tone[psg->latched_channel] |= (data << 4); //hhhhhh is upper 6 bit value of the 10 bit value
+				psg->tones[psg->latched_channel] &= 0xF;
+				psg->tones[psg->latched_channel] |= (data << 4); //hhhhhh is upper 6 bit value of the 10 bit value
 				break;
 
-			case 3: break; //noise channel
+			case 3:
+				psg->tones[PSG_NOISE_CHANNEL] = data & 0x7;
+				psg->lfsr = 0x8000;
+				break;
 			}
 		}
 	}
+
+	psgUpdateAmplitude(psg, psg->latched_channel, psg->buffer_time);
+}
+
+//Benchmark
+
+#define BENCH_FRAMES 600
+
+//Synthesizes BENCH_FRAMES of all 4 channels busy, with volume changes every
+//line like a game playing samples, and returns the ns taken per output sample
+static double psgBenchQuality(struct Psg* psg, enum PsgQuality quality, s16* samples)
+{
+	psgSetQuality(psg, quality);
+
+	u64 produced = 0;
+	clock_t start = clock();
+	for (u32 frame = 0; frame < BENCH_FRAMES; frame++) {
+		psgBeginFrame(psg);
+		for (u32 line = 0; line < SCANLINES_PER_FRAME; line++) {
+			psgWritePort(psg, 0x90 | (line & 0xF));
+			psgUpdate(psg, CYCLES_PER_SCANLINE);
+		}
+		psgSynthesize(psg);
+		produced += psgReadSamples(psg, samples, psgSamplesAvailable(psg));
+	}
+	double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	return (elapsed * 1000000000.0) / produced;
+}
+
+void psgBenchmark(void)
+{
+	static const char* qualities[] = { "linear", "16 tap", "64 tap" };
+	static const char* kernels[] = { "scalar", "sse2", "avx2", "neon" };
+
+	struct Psg* psg = (struct Psg*)malloc(sizeof(struct Psg));
+	if (psg == NULL)
+		return;
+	psgInit(psg);
+	s16* samples = (s16*)malloc(psg->buffer_size * sizeof(s16));
+
+	//3 tones and white noise at tone 2's rate, all at full volume
+	const u8 writes[] = { 0x8E, 0x0F, 0xA5, 0x03, 0xC1, 0x01, 0xE7, 0x90, 0xB0, 0xD0, 0xF0 };
+	psgBeginFrame(psg);
+	for (u32 i = 0; i < sizeof(writes); i++)
+		psgWritePort(psg, writes[i]);
+
+	enum SimdType selected = psgStepKernelType;
+
+	printf("PSG benchmark, ns per output sample at %u hz over %d frames\n", psg->sample_rate, BENCH_FRAMES);
+	printf("%-10s", "kernels");
+	for (s32 quality = 0; quality < PsgQualityCount; quality++)
+		printf(" %10s", qualities[quality]);
+	printf("\n");
+
+	for (s32 type = SimdScalar; type < SimdCount; type++) {
+		if (!psgSelectStepKernel(type))
+			continue;
+
+		printf("%-10s", kernels[type]);
+		for (s32 quality = 0; quality < PsgQualityCount; quality++)
+			printf(" %10.2f", psgBenchQuality(psg, quality, samples));
+		printf("\n");
+	}
+
+	psgSelectStepKernel(selected);
+	free(samples);
+	psgFree(psg);
+	free(psg);
 }
@@ -2,17 +2,99 @@
 #include "Util.h"
 #include "SFML\Audio.h"
 
-struct Psg {
-	u16 cycles;
+//SN76489, clocked at the cpu clock / 16
+#define PSG_CLOCK_DIVIDER 16
+#define PSG_DEFAULT_SAMPLE_RATE 44100
+
+//Output is made by adding a band limited step to a delta buffer whenever a
+//channel changes level, instead of ticking every psg clock. Each step is a
+//windowed sinc picked from PSG_BLEP_PHASES sub sample positions, so the step
+//tables work as a polyphase filter taking the psg clock straight to the host rate
+#define PSG_BLEP_MAX_WIDTH 64
+#define PSG_BLEP_PHASES 256
+#define PSG_BLEP_BITS 14 //fixed point precision of the step kernel, taps have to fit in 16 bits
+#define PSG_BUFFER_MS 100
+
+#define PSG_NOISE_CHANNEL 3
+
+//register writes a frame can log before the log is synthesized early
+#define PSG_LOG_SIZE 4096
+
+//Taps in each step, more taps cut more of the aliasing above the host's nyquist rate
+enum PsgQuality {
+	PsgQualityLinear = 0, //a step is split between the 2 samples it falls between
+	PsgQualityMedium, //16 tap windowed sinc
+	PsgQualityHigh, //64 tap windowed sinc
+	PsgQualityCount
+};
+
+struct PsgChannel {
+	u16 counter; //psg clocks until the output flips
+	u8 output; //square wave level, 0 or 1
+	s32 amplitude; //level the delta buffer is at for this channel
+};
 
+struct PsgWrite {
+	u32 cycle; //cpu cycles from the start of the log
+	u8 value;
+};
+
+struct Psg {
 	u8 latched_type;
 	u8 latched_channel;
 
-	u16 tones[4]; //tones for each channel
+	u16 tones[4]; //tones for each channel, tones[3] is the noise register
 	u8 volume[4]; //volume for each channel
 	u16 volume_table[0x10]; //volume lookup for the 4 channels (3 pulse, 1 noise)
+
+	struct PsgChannel channels[4];
+	u16 lfsr; //noise shift register, bit 0 is the noise output
+	u8 clock_remainder; //cpu cycles not yet making up a psg clock
+
+	//Delta buffer, time is in samples from the start of the buffer as 32.32 fixed point
+	s32* deltas;
+	u32 buffer_size;
+	u64 buffer_time;
+	u64 clock_step; //samples per psg clock, 32.32
+	u64 nominal_clock_step; //clock_step before rate control nudges it
+	u32 sample_rate;
+	s32 integrator; //running sum of the deltas read so far
+	enum PsgQuality quality;
+	u32 step_width; //taps added for each step, a multiple of 4
+
+	//Port writes are only logged while the cpu runs, psgSynthesize plays
+	//them back in one pass. The log is kept until psgBeginFrame so it can be
+	//read for vgm export or tests, write_log_overflow is set if it had to be
+	//cleared mid frame and only holds the end of the frame
+	struct PsgWrite write_log[PSG_LOG_SIZE];
+	u32 write_count;
+	u8 write_log_overflow;
+	u64 log_start; //cpu cycle the log starts at
+	u32 log_cycles; //cpu cycles since log_start
+	u32 synthesized_writes;
+	u32 synthesized_cycles;
+
+	struct Z80* z80; //for timestamping writes made partway through a z80Run batch
 };
 
 void psgInit(struct Psg* psg);
-void psgUpdate(struct Psg *psg, u8 cycles);
-void psgWritePort(struct Psg* psg, u8 value);
\ No newline at end of file
+void psgFree(struct Psg* psg);
+void psgConnectZ80(struct Psg* psg, struct Z80* z80);
+void psgSetSampleRate(struct Psg* psg, u32 sample_rate);
+void psgSetRateRatio(struct Psg* psg, double ratio);
+void psgSetQuality(struct Psg* psg, enum PsgQuality quality);
+u8 psgSelectStepKernel(enum SimdType type);
+void psgUpdate(struct Psg *psg, u16 cycles);
+void psgBeginFrame(struct Psg* psg);
+void psgSynthesize(struct Psg* psg);
+void psgSynthesizeUntil(struct Psg* psg, u32 cycle);
+void psgAdvance(struct Psg* psg, u32 cycles);
+void psgRun(struct Psg* psg, u32 clocks);
+void psgAddDelta(struct Psg* psg, u64 time, s32 delta);
+void psgUpdateAmplitude(struct Psg* psg, u8 channel, u64 time);
+u16 psgChannelPeriod(struct Psg* psg, u8 channel);
+u32 psgSamplesAvailable(struct Psg* psg);
+u32 psgReadSamples(struct Psg* psg, s16* samples, u32 count);
+void psgWritePort(struct Psg* psg, u8 value);
+void psgApplyWrite(struct Psg* psg, u8 value);
+void psgBenchmark(void);
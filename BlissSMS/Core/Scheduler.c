@@ -0,0 +1,73 @@
+#include "Scheduler.h"
+
+void schedulerInit(struct Scheduler* sched)
+{
+	sched->cycles = 0;
+	for (s32 i = 0; i < EventCount; i++) {
+		sched->events[i].timestamp = EVENT_NOT_SCHEDULED;
+		sched->events[i].callback = NULL;
+		sched->events[i].user = NULL;
+	}
+	schedulerFindNextEvent(sched);
+}
+
+void schedulerRegister(struct Scheduler* sched, enum SchedulerEventType type, scheduler_callback cb, void* user)
+{
+	sched->events[type].callback = cb;
+	sched->events[type].user = user;
+}
+
+void schedulerPost(struct Scheduler* sched, enum SchedulerEventType type, u64 timestamp)
+{
+	sched->events[type].timestamp = timestamp;
+	schedulerFindNextEvent(sched);
+}
+
+void schedulerCancel(struct Scheduler* sched, enum SchedulerEventType type)
+{
+	sched->events[type].timestamp = EVENT_NOT_SCHEDULED;
+	schedulerFindNextEvent(sched);
+}
+
+void schedulerFindNextEvent(struct Scheduler* sched)
+{
+	sched->next_event = EVENT_NOT_SCHEDULED;
+	sched->next_event_type = EventCount;
+
+	//ties go to the lowest event type
+	for (s32 i = 0; i < EventCount; i++) {
+		if (sched->events[i].timestamp < sched->next_event) {
+			sched->next_event = sched->events[i].timestamp;
+			sched->next_event_type = i;
+		}
+	}
+}
+
+s32 schedulerCyclesUntilNextEvent(struct Scheduler* sched)
+{
+	if (sched->next_event <= sched->cycles)
+		return 0;
+
+	u64 cycles = sched->next_event - sched->cycles;
+	if (cycles > 0x7FFFFFFF)
+		return 0x7FFFFFFF;
+
+	return (s32)cycles;
+}
+
+void schedulerAdvance(struct Scheduler* sched, u32 cycles)
+{
+	sched->cycles += cycles;
+
+	//handle everything that came due, callbacks may post new events
+	while (sched->next_event <= sched->cycles) {
+		struct SchedulerEvent* event = &sched->events[sched->next_event_type];
+		u64 timestamp = event->timestamp;
+
+		event->timestamp = EVENT_NOT_SCHEDULED;
+		schedulerFindNextEvent(sched);
+
+		if (event->callback)
+			event->callback(event->user, timestamp);
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Util.h"
+
+#define EVENT_NOT_SCHEDULED 0xFFFFFFFFFFFFFFFFULL
+
+//Timed device events, events due on the same cycle are handled in this order
+enum SchedulerEventType {
+	EventVdpLineEnd = 0,
+	EventVdpLineIrq,
+	EventVdpVBlank,
+	EventVdpFrameEnd,
+	EventCount
+};
+
+typedef void (*scheduler_callback)(void* user, u64 timestamp);
+
+struct SchedulerEvent {
+	u64 timestamp; //master cycle the event is due on
+	scheduler_callback callback;
+	void* user;
+};
+
+//Keeps the master cycle count and the next timestamp each device posted,
+//so the cpu can run uninterrupted until the earliest one is due
+struct Scheduler {
+	u64 cycles;
+	u64 next_event;
+	u8 next_event_type;
+
+	struct SchedulerEvent events[EventCount];
+};
+
+void schedulerInit(struct Scheduler* sched);
+void schedulerRegister(struct Scheduler* sched, enum SchedulerEventType type, scheduler_callback cb, void* user);
+void schedulerPost(struct Scheduler* sched, enum SchedulerEventType type, u64 timestamp);
+void schedulerCancel(struct Scheduler* sched, enum SchedulerEventType type);
+void schedulerFindNextEvent(struct Scheduler* sched);
+s32 schedulerCyclesUntilNextEvent(struct Scheduler* sched);
+void schedulerAdvance(struct Scheduler* sched, u32 cycles);
@@ -11,13 +11,18 @@ void systemInit(struct System* sys)
 	z80ConnectBus(&sys->z80, &sys->bus);
 	z80ConnectIo(&sys->z80, &sys->io);
 	
+	schedulerInit(&sys->sched);
+
 	vdpInit(&sys->vdp);
 	vdpConnectIo(&sys->vdp, &sys->io);
+	vdpConnectScheduler(&sys->vdp, &sys->sched);
 	ioConnectVdp(&sys->io, &sys->vdp);
-	sys->vdp.sys = &sys;
+	sys->vdp.sys = sys;
 
-	psgInit(&sys, &sys->psg);
+	psgInit(&sys->psg);
+	psgConnectZ80(&sys->psg, &sys->z80);
 	ioConnectPsg(&sys->io, &sys->psg);
+	audioInit(&sys->audio);
 
 	joypadInit(&sys->joy);
 	ioConnectJoypad(&sys->io, &sys->joy);
@@ -77,24 +82,49 @@ void systemRunEmulation(struct System* sys)
 		struct Psg* psg = &sys->psg;
 		struct Z80* z80 = &sys->z80;
 		struct Joypad* joy = &sys->joy;
+		struct Scheduler* sched = &sys->sched;
+
+		psgBeginFrame(psg);
 
 		s32 cycles_this_frame = 0;
 		while (!vdpFrameComplete(vdp)) {
-			u16 cycles = z80Clock(z80);
+			//run the cpu uninterrupted up to the next scheduled event, z80Run
+			//returns early when the interrupt state changes so it can be serviced
+			u32 cycles = z80Run(z80, schedulerCyclesUntilNextEvent(sched));
 			cycles_this_frame += cycles;
 
-			vdpUpdate(vdp, cycles);
+			schedulerAdvance(sched, cycles);
 			psgUpdate(psg, cycles);
 			if (sys->z80.process_interrupt_delay)
 				continue;
 
 			z80HandleInterrupts(z80, vdp);
 		}
+		psgSynthesize(psg);
+		systemUpdateAudio(sys);
+
 		joypadUpdate(joy);
 		vdpBufferPixels(vdp);
 	}
 }
 
+//Plays the psg at its current sample rate
+u8 systemStartAudio(struct System* sys, u32 latency_ms)
+{
+	return audioStart(&sys->audio, sys->psg.sample_rate, latency_ms);
+}
+
+//Moves the samples synthesized this frame into the audio ring
+void systemUpdateAudio(struct System* sys)
+{
+	if (sys->audio.stream == NULL)
+		return;
+
+	u32 count;
+	while ((count = psgReadSamples(&sys->psg, sys->audio_frame, AUDIO_FRAME_SAMPLES)) > 0)
+		audioPush(&sys->audio, sys->audio_frame, count);
+}
+
 void systemRenderGraphics(struct System* sys, sfRenderWindow *window)
 {
 	vdpDisplayGraphics(&sys->vdp, window);
@@ -112,6 +142,7 @@ void systemHandleInput(struct System *sys, sfEvent* ev)
 		if (ev->key.code == B) joypadButtonPressed(joy, B, 1);
 		if (ev->key.code == sfKeySpace) {
 			sys->z80.service_nmi = 1;
+			sys->z80.irq_line_changed = 1;
 		}
 		if (ev->key.code == sfKeyTab) {
 			ioResetButtonPressed(&sys->io, 1);
@@ -135,6 +166,7 @@ void systemFree(struct System* sys)
 	cartDumpSram(&sys->cart);
 	cartFree(&sys->cart);
 	vdpFree(&sys->vdp);
+	audioStop(&sys->audio);
 	psgFree(&sys->psg);
 }
 
@@ -4,8 +4,10 @@
 #include "Z80.h"
 #include "Vdp.h"
 #include "Psg.h"
+#include "Audio.h"
 #include "Joypad.h"
 #include "Cart.h"
+#include "Scheduler.h"
 #include "Log.h"
 
 #define CPU_CLOCK 3579545
@@ -13,6 +15,7 @@
 #define FPS 60
 #define CYCLES_PER_SCANLINE 228
 #define MAX_CYCLES_PER_FRAME SCANLINES_PER_FRAME * CYCLES_PER_SCANLINE
+#define FRAME_RATE ((double)CPU_CLOCK / (SCANLINES_PER_FRAME * CYCLES_PER_SCANLINE)) //about 59.92
 
 
 struct ApuCallbackData {
@@ -32,8 +35,11 @@ struct System {
 	struct Z80 z80;
 	struct Vdp vdp;
 	struct Psg psg;
+	struct Audio audio;
+	s16 audio_frame[AUDIO_FRAME_SAMPLES]; //psg samples on their way to the audio ring
 	struct Joypad joy;
 	struct Cart cart;
+	struct Scheduler sched;
 
 	struct Log log;
 
@@ -47,6 +53,8 @@ struct System {
 
 void systemInit(struct System* sys);
 void systemRunEmulation(struct System* sys);
+u8 systemStartAudio(struct System* sys, u32 latency_ms);
+void systemUpdateAudio(struct System* sys);
 void systemRenderGraphics(struct System* sys, sfRenderWindow *window);
 void systemHandleInput(struct System *sys, sfEvent* ev);
 void systemFree(struct System* sys);
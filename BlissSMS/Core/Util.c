@@ -1,5 +1,11 @@
 #include "Util.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(SIMD_X86)
+#include <cpuid.h>
+#endif
+
 u8 popcount(u8 value)
 {
 	u8 count = 0;
@@ -24,3 +30,81 @@ u8 testBit(u8 val, u8 bit)
 {
 	return (val >> bit) & 0x1;
 }
+
+u32 atomicLoad(volatile u32* value)
+{
+#if defined(_MSC_VER)
+	return (u32)_InterlockedCompareExchange((volatile long*)value, 0, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#endif
+}
+
+void atomicStore(volatile u32* value, u32 new_value)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchange((volatile long*)value, (long)new_value);
+#else
+	__atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#endif
+}
+
+#ifdef SIMD_X86
+
+static void simdCpuid(u32 leaf, u32 subleaf, u32 regs[4])
+{
+#if defined(_MSC_VER)
+	__cpuidex((int*)regs, leaf, subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static u64 simdXgetbv(void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	u32 eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((u64)edx << 32) | eax;
+#endif
+}
+
+#endif
+
+u8 simdSupported(enum SimdType type)
+{
+	switch (type) {
+		case SimdScalar: return 1;
+#ifdef SIMD_X86
+		case SimdSse2: {
+#if defined(_M_X64) || defined(__x86_64__)
+			return 1; //always there on x64
+#else
+			u32 regs[4];
+			simdCpuid(1, 0, regs);
+			return (regs[3] >> 26) & 0x1;
+#endif
+		}
+		case SimdAvx2: {
+			u32 regs[4];
+			simdCpuid(0, 0, regs);
+			if (regs[0] < 7) return 0;
+
+			//os has to save the ymm registers too
+			simdCpuid(1, 0, regs);
+			u8 osxsave = (regs[2] >> 27) & 0x1;
+			u8 avx = (regs[2] >> 28) & 0x1;
+			if (!osxsave || !avx || (simdXgetbv() & 0x6) != 0x6) return 0;
+
+			simdCpuid(7, 0, regs);
+			return (regs[1] >> 5) & 0x1;
+		}
+#endif
+#ifdef SIMD_NEON
+		case SimdNeon: return 1;
+#endif
+		default: return 0;
+	}
+}
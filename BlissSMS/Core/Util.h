@@ -3,15 +3,49 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SIMD_NEON 1
+#endif
+
+//gcc and clang only emit instructions for the extensions a function is built for,
+//msvc allows any intrinsic anywhere
+#if defined(_MSC_VER)
+#define SIMD_TARGET(isa)
+#else
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
 typedef unsigned char u8;
 typedef signed char s8;
 typedef unsigned short u16;
 typedef signed short s16;
 typedef unsigned int u32;
 typedef signed int s32;
+typedef unsigned long long u64;
+
+//Instruction sets the simd loops are written for
+enum SimdType {
+	SimdScalar = 0,
+	SimdSse2,
+	SimdAvx2,
+	SimdNeon,
+	SimdCount
+};
 
 //Returns number of set bits in value
 u8 popcount(u8 value);
 u8 setBit(u8 val, u8 bit);
 u8 clearBit(u8 val, u8 bit);
-u8 testBit(u8 val, u8 bit);
\ No newline at end of file
+u8 testBit(u8 val, u8 bit);
+
+//Loads and stores of counters shared between two threads, the release store
+//makes everything written before it visible to the thread that sees the new value
+u32 atomicLoad(volatile u32* value);
+void atomicStore(volatile u32* value, u32 new_value);
+
+//Returns 1 when the host cpu and os can run code built for type
+u8 simdSupported(enum SimdType type);
@@ -1,9 +1,38 @@
 #include "Vdp.h"
 #include "Io.h"
 #include "System.h"
+#include "VdpKernels.h"
+#include "VdpWorker.h"
+
+//All 64 colors the vdp can show, cram color --bbggrr with each
+//channel scaled to 0, 85, 170 or 255, in each pixel format
+const u32 vdpMasterPalette[2][64] = {
+	{ //rgba
+		0xFF000000, 0xFF000055, 0xFF0000AA, 0xFF0000FF, 0xFF005500, 0xFF005555, 0xFF0055AA, 0xFF0055FF,
+		0xFF00AA00, 0xFF00AA55, 0xFF00AAAA, 0xFF00AAFF, 0xFF00FF00, 0xFF00FF55, 0xFF00FFAA, 0xFF00FFFF,
+		0xFF550000, 0xFF550055, 0xFF5500AA, 0xFF5500FF, 0xFF555500, 0xFF555555, 0xFF5555AA, 0xFF5555FF,
+		0xFF55AA00, 0xFF55AA55, 0xFF55AAAA, 0xFF55AAFF, 0xFF55FF00, 0xFF55FF55, 0xFF55FFAA, 0xFF55FFFF,
+		0xFFAA0000, 0xFFAA0055, 0xFFAA00AA, 0xFFAA00FF, 0xFFAA5500, 0xFFAA5555, 0xFFAA55AA, 0xFFAA55FF,
+		0xFFAAAA00, 0xFFAAAA55, 0xFFAAAAAA, 0xFFAAAAFF, 0xFFAAFF00, 0xFFAAFF55, 0xFFAAFFAA, 0xFFAAFFFF,
+		0xFFFF0000, 0xFFFF0055, 0xFFFF00AA, 0xFFFF00FF, 0xFFFF5500, 0xFFFF5555, 0xFFFF55AA, 0xFFFF55FF,
+		0xFFFFAA00, 0xFFFFAA55, 0xFFFFAAAA, 0xFFFFAAFF, 0xFFFFFF00, 0xFFFFFF55, 0xFFFFFFAA, 0xFFFFFFFF
+	},
+	{ //bgra
+		0xFF000000, 0xFF550000, 0xFFAA0000, 0xFFFF0000, 0xFF005500, 0xFF555500, 0xFFAA5500, 0xFFFF5500,
+		0xFF00AA00, 0xFF55AA00, 0xFFAAAA00, 0xFFFFAA00, 0xFF00FF00, 0xFF55FF00, 0xFFAAFF00, 0xFFFFFF00,
+		0xFF000055, 0xFF550055, 0xFFAA0055, 0xFFFF0055, 0xFF005555, 0xFF555555, 0xFFAA5555, 0xFFFF5555,
+		0xFF00AA55, 0xFF55AA55, 0xFFAAAA55, 0xFFFFAA55, 0xFF00FF55, 0xFF55FF55, 0xFFAAFF55, 0xFFFFFF55,
+		0xFF0000AA, 0xFF5500AA, 0xFFAA00AA, 0xFFFF00AA, 0xFF0055AA, 0xFF5555AA, 0xFFAA55AA, 0xFFFF55AA,
+		0xFF00AAAA, 0xFF55AAAA, 0xFFAAAAAA, 0xFFFFAAAA, 0xFF00FFAA, 0xFF55FFAA, 0xFFAAFFAA, 0xFFFFFFAA,
+		0xFF0000FF, 0xFF5500FF, 0xFFAA00FF, 0xFFFF00FF, 0xFF0055FF, 0xFF5555FF, 0xFFAA55FF, 0xFFFF55FF,
+		0xFF00AAFF, 0xFF55AAFF, 0xFFAAAAFF, 0xFFFFAAFF, 0xFF00FFFF, 0xFF55FFFF, 0xFFAAFFFF, 0xFFFFFFFF
+	}
+};
 
 void vdpInit(struct Vdp* vdp)
 {
+	vdpKernelsInit();
+
 	memset(vdp->registers, 0xFF, 0xB);
 	memset(vdp->vram, 0x0, 0x4000);
 	memset(vdp->cram, 0x0, 0x20);
@@ -28,7 +57,7 @@ void vdpInit(struct Vdp* vdp)
 	vdp->registers[0xA] = 0xFF;
 
 	vdp->state = Visible;
-	vdp->cycles = 0;
+	vdp->sched = NULL;
 	vdp->mode = Mode4;
 	vdp->line_int_pending = 0;
 	vdp->frame_int_pending = 0;
@@ -37,7 +66,30 @@ void vdpInit(struct Vdp* vdp)
 	vdp->sprite_collision = 0;
 	vdp->y_scroll = 0;
 	
-	memset(vdp->priority_buffer, 0x0, DISPLAY_WIDTH);
+	memset(vdp->priority_mask, 0x0, sizeof(vdp->priority_mask));
+	memset(vdp->line_buffer, 0x0, DISPLAY_WIDTH + 8);
+	vdp->render_mode = RenderFull;
+	vdp->frame_skip = 0;
+	vdp->frame_skip_period = 0;
+	vdp->frame_skipped = 0;
+	vdp->last_frame_skipped = 0;
+	vdp->frame_count = 0;
+	vdp->frames_rendered = 0;
+	vdp->frames_skipped = 0;
+
+	vdp->deferred_render = 1;
+	vdp->pending_line = 0;
+	vdp->pending_lines = 0;
+	vdp->catch_ups = 0;
+	vdp->lines_caught_up = 0;
+
+	//decode every pattern before the first line is drawn
+	vdp->dirty_pattern_count = 0;
+	memset(vdp->pattern_dirty, 0x0, PATTERN_COUNT);
+	for (u16 pattern = 0; pattern < PATTERN_COUNT; pattern++)
+		vdpMarkPatternDirty(vdp, pattern * PATTERN_SIZE);
+	vdp->pattern_cache_hits = 0;
+	vdp->pattern_cache_misses = 0;
 
 	vdp->vdp_control = 0x0;
 	vdp->vdp_data = 0x0;
@@ -53,11 +105,14 @@ void vdpInit(struct Vdp* vdp)
 	vdp->display_height = DISPLAY_HEIGHT;
 	vdp->frame_complete = 0;
 
-	vdp->pixels = sfImage_createFromColor(DISPLAY_WIDTH, DISPLAY_HEIGHT, sfBlack);
-	if (vdp->pixels == NULL)
-		printf("Image failed to create\n");
+	vdp->worker = NULL;
+	vdpUpdateFrameRenderMode(vdp);
+	vdp->owned_pixels = (u32*)malloc(DISPLAY_WIDTH * DISPLAY_HEIGHT * sizeof(u32));
+	if (vdp->owned_pixels == NULL)
+		printf("Framebuffer failed to allocate\n");
+	vdpSetFramebuffer(vdp, NULL, 0, PixelRgba);
 
-	vdp->framebuffer = sfTexture_createFromImage(vdp->pixels, NULL);
+	vdp->framebuffer = sfTexture_create(DISPLAY_WIDTH, DISPLAY_HEIGHT);
 	if (vdp->framebuffer == NULL)
 		printf("Texture failed to create\n");
 
@@ -66,11 +121,15 @@ void vdpInit(struct Vdp* vdp)
 
 	sfVector2f scale = { 2, 2 };
 	sfSprite_setScale(vdp->frame, scale);
+
+	vdpLoadSpriteY(vdp);
 }
 
 void vdpFree(struct Vdp* vdp)
 {
-	sfImage_destroy(vdp->pixels);
+	vdpWorkerStop(vdp);
+	if (vdp->owned_pixels != NULL)
+		free(vdp->owned_pixels);
 	sfTexture_destroy(vdp->framebuffer);
 	sfSprite_destroy(vdp->frame);
 }
@@ -80,52 +139,134 @@ void vdpConnectIo(struct Vdp *vdp, struct Io* io)
 	vdp->io = io;
 }
 
-void vdpUpdate(struct Vdp *vdp, u8 cycles)
+void vdpConnectScheduler(struct Vdp* vdp, struct Scheduler* sched)
 {
-	vdp->cycles += cycles;
-	if (vdp->cycles >= CYCLES_PER_SCANLINE) {
-		if (vdp->vcounter <= 192) {
-			vdp->line_counter--;
+	vdp->sched = sched;
+	schedulerRegister(sched, EventVdpLineEnd, vdpLineEnd, vdp);
+	schedulerRegister(sched, EventVdpLineIrq, vdpLineIrq, vdp);
+	schedulerRegister(sched, EventVdpVBlank, vdpVBlank, vdp);
+	schedulerRegister(sched, EventVdpFrameEnd, vdpFrameEnd, vdp);
+
+	//current line starts now
+	schedulerPost(sched, EventVdpLineEnd, sched->cycles + CYCLES_PER_SCANLINE);
+	vdpScheduleFrame(vdp, sched->cycles - ((u64)vdp->vcounter * CYCLES_PER_SCANLINE));
+	vdpScheduleLineIrq(vdp, sched->cycles);
+}
 
-			//underflow from 0 to 0xFF sets line irq and reloads line counter
-			if (vdp->line_counter == 0xFF) {
-				vdp->line_counter = vdp->registers[0xA];
-				vdp->line_int_pending = 1;
-			}
+void vdpScheduleFrame(struct Vdp* vdp, u64 frame_start)
+{
+	//frame interrupt is raised once line 196 is reached
+	schedulerPost(vdp->sched, EventVdpVBlank, frame_start + (196 * CYCLES_PER_SCANLINE));
+	schedulerPost(vdp->sched, EventVdpFrameEnd, frame_start + (SCANLINES_PER_FRAME * CYCLES_PER_SCANLINE));
+}
+
+void vdpScheduleLineIrq(struct Vdp* vdp, u64 line_start)
+{
+	//the line counter only counts down at the end of lines 0 - 192, once it has been
+	//reloaded during vblank it next runs from the start of the following frame
+	u16 line = vdp->vcounter;
+	if (line > 192) {
+		line_start += (u64)(SCANLINES_PER_FRAME - line) * CYCLES_PER_SCANLINE;
+		line = 0;
+	}
 
-				//Render at start of new line
-			if (vdpIsDisplayVisible(vdp)) {
-				if (vdpIsDisplayActive(vdp)) {
-					vdpRender(vdp);
+	//underflow from 0 to 0xFF happens at the end of line (line + counter)
+	if (line + vdp->line_counter <= 192) {
+		u64 timestamp = line_start + ((u64)(vdp->line_counter + 1) * CYCLES_PER_SCANLINE);
+		schedulerPost(vdp->sched, EventVdpLineIrq, timestamp);
+	}
+	else
+		schedulerCancel(vdp->sched, EventVdpLineIrq);
+}
+
+void vdpLineEnd(void* user, u64 timestamp)
+{
+	struct Vdp* vdp = (struct Vdp*)user;
+	if (vdp->vcounter <= 192) {
+		//underflow is handled by the line irq event posted for this line
+		vdp->line_counter--;
+
+		//Render at start of new line
+		if (vdpIsDisplayVisible(vdp)) {
+			if (vdpIsDisplayActive(vdp)) {
+				if (vdp->deferred_render) {
+					//drawn by the next catch up, nothing the line
+					//depends on has changed since it ended
+					if (vdp->pending_lines == 0)
+						vdp->pending_line = vdp->vcounter;
+					vdp->pending_lines++;
 				}
+				else
+					vdpRenderLine(vdp);
 			}
 		}
+	}
 
-		vdp->cycles -= CYCLES_PER_SCANLINE;
-		vdp->vcounter++;
-		vdp->vcount_port++;
+	vdp->vcounter++;
+	vdp->vcount_port++;
 
-		vdpScanlineUpdate(vdp);
-	}
+	vdpScanlineUpdate(vdp, timestamp);
+	schedulerPost(vdp->sched, EventVdpLineEnd, timestamp + CYCLES_PER_SCANLINE);
+}
+
+void vdpLineIrq(void* user, u64 timestamp)
+{
+	struct Vdp* vdp = (struct Vdp*)user;
+
+	//underflow from 0 to 0xFF sets line irq and reloads line counter
+	vdp->line_counter = vdp->registers[0xA];
+	vdp->line_int_pending = 1;
+
+	vdpScheduleLineIrq(vdp, timestamp);
 }
 
-void vdpScanlineUpdate(struct Vdp* vdp)
+void vdpVBlank(void* user, u64 timestamp)
+{
+	struct Vdp* vdp = (struct Vdp*)user;
+	(void)timestamp; //the frame irq is raised as soon as the event fires
+	vdp->frame_int_pending = 1;
+}
+
+void vdpFrameEnd(void* user, u64 timestamp)
+{
+	struct Vdp* vdp = (struct Vdp*)user;
+	vdpCatchUp(vdp);
+	vdp->frame_complete = 1;
+	vdp->vcounter = 0;
+	vdp->vcount_port = 0;
+
+	vdp->last_frame_skipped = vdp->frame_skipped;
+	if (vdp->frame_skipped)
+		vdp->frames_skipped++;
+	else
+		vdp->frames_rendered++;
+	vdp->frame_count++;
+
+	//pick how the next frame is drawn
+	vdp->frame_skipped = 0;
+	if (vdp->frame_skip_period != 0)
+		vdp->frame_skipped = (vdp->frame_count % vdp->frame_skip_period) < vdp->frame_skip;
+	vdpUpdateFrameRenderMode(vdp);
+
+	vdpScheduleFrame(vdp, timestamp);
+}
+
+void vdpScanlineUpdate(struct Vdp* vdp, u64 line_start)
 {
 	//reload line counter between lines 193 - 261
-	if(vdp->vcounter >= 193 && vdp->vcounter <= 261)
+	if (vdp->vcounter >= 193 && vdp->vcounter <= 261) {
 		vdp->line_counter = vdp->registers[0xA];
+		vdpScheduleLineIrq(vdp, line_start);
+	}
 
+	//frame interrupt (line 196) and frame end (line 262) are scheduler events
 	switch (vdp->vcounter) {
-		case 193: vdp->y_scroll = vdp->registers[0x9]; break; //y scroll is only updated once the display enters vblank
-		//attempt to generate frame interrupt (Vblank period)
-		case 196: vdp->frame_int_pending = 1; break;
+		case 193:
+			//y scroll is only updated once the display enters vblank
+			vdpCatchUp(vdp);
+			vdp->y_scroll = vdp->registers[0x9];
+			break;
 		case 218: vdp->vcount_port = 213; break;
-		case 262: {
-			vdp->frame_complete = 1;
-			vdp->vcounter = 0;
-			vdp->vcount_port = 0;
-		}
-		break;
 	}
 }
 
@@ -136,29 +277,75 @@ void vdpDisplayGraphics(struct Vdp* vdp, sfRenderWindow *window)
 
 void vdpRender(struct Vdp* vdp)
 {
+	vdpUpdatePatternCache(vdp);
 	vdpSetMode(vdp);
 	if (vdp->mode == Mode4) {
+		if (vdp->frame_render_mode == RenderStatusOnly) {
+			//the flags only change on lines with sprites
+			vdpUpdateSpriteLines(vdp);
+			if (vdp->line_sprite_count[vdp->vcounter] == 0)
+				return;
+		}
+
 		vdpRenderBackground(vdp);
 		vdpRenderSprites(vdp);
+		if (vdp->frame_render_mode == RenderFull)
+			vdpOutputLine(vdp);
 	}
 }
 
+void vdpRenderLine(struct Vdp* vdp)
+{
+	vdpRender(vdp);
+	//with a worker only the status flags were found, it draws the line
+	if (vdp->worker != NULL && !vdp->frame_skipped)
+		vdpWorkerPushLine(vdp->worker, 1);
+}
+
+//Draws every line that ended since the last catch up. Called before a vram, cram
+//or register write and before the status flags or pixels are read, so each
+//line is drawn with the state it ended with
+void vdpCatchUp(struct Vdp* vdp)
+{
+	if (vdp->pending_lines == 0)
+		return;
+
+	u16 vcounter = vdp->vcounter;
+	for (u16 line = 0; line < vdp->pending_lines; line++) {
+		vdp->vcounter = vdp->pending_line + line;
+		vdpRenderLine(vdp);
+	}
+	vdp->vcounter = vcounter;
+
+	vdp->lines_caught_up += vdp->pending_lines;
+	vdp->catch_ups++;
+	vdp->pending_lines = 0;
+}
+
+//Lines are drawn as they end when deferred rendering is off
+void vdpSetDeferredRendering(struct Vdp* vdp, u8 enabled)
+{
+	vdpCatchUp(vdp);
+	vdp->deferred_render = enabled;
+}
+
 void vdpRenderBackground(struct Vdp* vdp)
 {
 	u16 line = vdp->vcounter;
 	u16 nametable_base_addr = vdpGetNameTableBaseAddress(vdp);
 
 	u8 mask_first_col = (vdp->registers[0] >> 5) & 0x1;
+	u8 overscan_bgdrop_color = vdp->registers[0x7] & 0xF;
 
 	s32 row = line;
 	row /= 8; //a row is 8 pixels large
 
-	//Horizontal scroll
+	//Horizontal scroll, whole screen is shifted right by x scroll
+	//and wraps around the display width
 	u8 x_scroll = vdp->registers[0x8];
-	u8 x_start_col = (x_scroll >> 3) & 0x1F;
-	u8 x_fine_scroll = x_scroll & 0x7;
-
 	u8 disable_xscroll = (vdp->registers[0] >> 6) & 0x1; //disable xscrolling for rows 0 - 1
+	if (disable_xscroll && row <= 1)
+		x_scroll = 0;
 
 	//Vertical scroll
 	u8 y_scroll = vdp->y_scroll;
@@ -166,120 +353,72 @@ void vdpRenderBackground(struct Vdp* vdp)
 	u8 y_fine_scroll = y_scroll & 0x7;
 
 	u8 disable_yscroll = (vdp->registers[0] >> 7) & 0x1;
-	
-	//32 columns per scanline (32 x 28 tiles)
-	for (s32 column = 0; column < 32; column++) {
-		//draw 8 pixels of the tile in this column
-		for (u8 x = 0; x < 8; x++) {
-			s32 xpixel_pos = x + (column * 8);
-
-			u8 use_xscroll = 0;
-			if ((row > 1) || !disable_xscroll)
-				use_xscroll = 1;
-			
-			if (use_xscroll) {
-				xpixel_pos = x_start_col; //horizontal start column
-				xpixel_pos *= 8; //each col is 8 pixels
-				xpixel_pos += ((x + x_fine_scroll)); //add current pixel and fine scroll value to the position
-				xpixel_pos = xpixel_pos % DISPLAY_WIDTH; //wrap with display width if position exceeds it
-			}
 
-			//Vertical scrolling
-			u8 use_yscroll = 1;
-			//if col is less than 23 allow y scrolling (y scrolling disabled if drawing columns 24 - 32)
-			//and if disable y scroll is not set
-			if (disable_yscroll && column >= 24)
-				use_yscroll = 0;
-
-			u16 vertical_offset = row;
-			if (use_yscroll) {
-				vertical_offset += y_start_row; //add starting row value
-				s32 add_row = line % 8; //add fine scroll value (might move us to next row)
-				if ((add_row + y_fine_scroll) > 7)
-					vertical_offset++;
-
-				//wrap
-				s32 num_rows = 28;
-				vertical_offset %= num_rows;
-			}
-	
-			//Tile map data
-			u16 nametable_base_offset = nametable_base_addr;
-			nametable_base_offset += vertical_offset * (32 * 2); //each scanline has 32 tiles (1 tile per column) but 1 tile is 2 bytes in memory
-			nametable_base_offset += column * 2; //each tile is two bytes in memory
-
-			//Get 2 byte tile data
-			u16 tile_data = vdp->vram[nametable_base_offset + 1] << 8;
-			tile_data |= vdp->vram[nametable_base_offset];
-
-			u8 priority = (tile_data >> 12) & 0x1;
-			u8 palette_select = (tile_data >> 11) & 0x1;
-			u8 vertical_flip = (tile_data >> 10) & 0x1;
-			u8 horizontal_flip = (tile_data >> 9) & 0x1;
-			u16 pattern_index = (tile_data & 0x1FF); //pattern index for tile to retrieve
-
-			s32 offset = line; //offset will point to which line of pattern to draw
-			
-			if (use_yscroll)
-				offset += y_scroll;
-
-			offset %= 8; //tile is 8 pixels so wrap if gone past
-
-			if (vertical_flip) {
-				//invert offset
-				offset *= -1;
-				offset += 7;
-			}
+	//Name table row and pattern line with and without vertical scrolling
+	u16 scrolled_row = row + y_start_row;
+	if (((line % 8) + y_fine_scroll) > 7) //fine scroll might move us to next row
+		scrolled_row++;
+	scrolled_row %= 28; //wrap
 
-			//each pattern is 32 bytes in memory
-			pattern_index *= 32;
-			//each pattern line is 4 bytes, offset contains correct pattern line
-			pattern_index += 4 * offset;
-
-			//get pattern line data
-			u8 d1 = vdp->vram[pattern_index];
-			u8 d2 = vdp->vram[pattern_index + 1];
-			u8 d3 = vdp->vram[pattern_index + 2];
-			u8 d4 = vdp->vram[pattern_index + 3];
-
-			u8 color_bit = 7 - x; //color is read left to right
-			if(horizontal_flip)
-				color_bit = x; //color read from right to left
-
-			//Get which palette for this pattern line
-			u8 palette = testBit(d4, color_bit) << 3;
-			palette |= testBit(d3, color_bit) << 2;
-			palette |= testBit(d2, color_bit) << 1;
-			palette |= testBit(d1, color_bit);
-
-			//a tile can only have high priority if it isnt palette 0
-			if (palette == 0) priority = 0;
-			if (palette_select) palette += 16; //sprite palette is used
-
-			u8 color = 0;
-			if (mask_first_col && (xpixel_pos < 8)) {
-				u8 overscan_bgdrop_color = vdp->registers[0x7] & 0xF;
-				color = vdp->cram[overscan_bgdrop_color + 16]; //color is from sprite palette
-			}
-			else
-				color = vdp->cram[palette];
+	u8 scrolled_line = (line + y_scroll) % 8;
+	u8 fixed_line = line % 8;
 
-			u8 red = color & 0x3;
-			u8 green = (color >> 2) & 0x3;
-			u8 blue = (color >> 4) & 0x3;
+	memset(vdp->priority_mask, 0x0, sizeof(vdp->priority_mask));
+	
+	//32 columns per scanline (32 x 28 tiles), each tile
+	//row is fetched once and its 8 pixels drawn together
+	for (s32 column = 0; column < 32; column++) {
+		//y scrolling disabled if drawing columns 24 - 32 and disable y scroll is set
+		u8 use_yscroll = !(disable_yscroll && column >= 24);
+
+		u16 vertical_offset = use_yscroll ? scrolled_row : row;
+		s32 offset = use_yscroll ? scrolled_line : fixed_line; //which line of pattern to draw
+
+		//Tile map data, each tile is two bytes in memory and 32 tiles per row
+		u16 nametable_base_offset = nametable_base_addr + (vertical_offset * (32 * 2)) + (column * 2);
+
+		//Get 2 byte tile data
+		u16 tile_data = vdp->vram[nametable_base_offset + 1] << 8;
+		tile_data |= vdp->vram[nametable_base_offset];
+
+		u8 priority = (tile_data >> 12) & 0x1;
+		u8 palette_select = (tile_data >> 11) & 0x1;
+		u8 vertical_flip = (tile_data >> 10) & 0x1;
+		u8 horizontal_flip = (tile_data >> 9) & 0x1;
+		u16 pattern_index = (tile_data & 0x1FF); //pattern index for tile to retrieve
+
+		if (vertical_flip)
+			offset = 7 - offset; //invert offset
+
+		//leftmost screen pixel of this tile. A tile can only have high priority
+		//if it isnt palette 0, sprite is drawn under tile if priority is set
+		u8 tile_x = (column * 8) + x_scroll;
+		if (priority) {
+			u8 opaque = vdp->pattern_opaque[pattern_index][horizontal_flip][offset];
+			vdpLineMaskSet(vdp->priority_mask, tile_x, opaque);
+			if (tile_x > DISPLAY_WIDTH - 8) //wrap the part past the right edge
+				vdp->priority_mask[0] |= opaque >> (DISPLAY_WIDTH - tile_x);
+		}
 
-			if (xpixel_pos >= vdp->display_width)
-				continue;
+		if (vdp->frame_render_mode == RenderFull) {
+			//decoded pattern line, already flipped horizontally if needed
+			const u8* pattern_line = &vdp->pattern_cache[pattern_index][horizontal_flip][offset * 8];
+			vdp->pattern_cache_hits++;
 
-			//sprite is drawn under tile if priority is set and pal isnt 0
-			if (priority && palette != 0) vdp->priority_buffer[xpixel_pos] = 1;
-			else vdp->priority_buffer[xpixel_pos] = 0;
-			
-			sfImage_setPixel(vdp->pixels, xpixel_pos, line, vdpGetColor(red, green, blue));
+			u8 palette_offset = palette_select ? 16 : 0; //sprite palette is used
+			vdpKernels.tile_row(pattern_line, palette_offset, &vdp->line_buffer[tile_x]);
 		}
-		x_start_col++;
-		x_start_col %= 32; //move onto next column and keep within 32 col range
 	}
+
+	if (vdp->frame_render_mode == RenderStatusOnly)
+		return;
+
+	//wrap the part of the tile drawn past the right edge
+	u8 x_fine_scroll = x_scroll & 0x7;
+	memcpy(vdp->line_buffer, &vdp->line_buffer[DISPLAY_WIDTH], x_fine_scroll);
+
+	if (mask_first_col) //color is from sprite palette
+		memset(vdp->line_buffer, overscan_bgdrop_color + 16, 8);
 }
 
 void vdpRenderSprites(struct Vdp* vdp)
@@ -289,96 +428,190 @@ void vdpRenderSprites(struct Vdp* vdp)
 
 	u8 shift_sprites_left = (vdp->registers[0] >> 3) & 0x1;
 	u8 is_sprite_8x16 = (vdp->registers[1] >> 1) & 0x1; //0 = 8x8, 1 = 8x16
-	u8 is_sprite_doubled = (vdp->registers[1] & 0x1);
 	u8 use_second_pattern = (vdp->registers[6] >> 2) & 0x1;
-	u8 sprite_count = 0;
-	u8 sprites_drawn[DISPLAY_WIDTH] = { 0 };
+	u64 sprites_drawn[LINE_MASK_WORDS] = { 0 };
 
-	u8 sprite_size = 8;
-	if (is_sprite_8x16 || is_sprite_doubled)
-		sprite_size = 16;
+	vdpUpdateSpriteLines(vdp);
+	u8 sprite_count = vdp->line_sprite_count[line];
+	if (sprite_count > SPRITES_PER_LINE) { //only 8 sprites per line allowed, set overflow
+		vdp->sprite_overflow = 1;
+		sprite_count = SPRITES_PER_LINE;
+	}
 
-	for (s32 sprite = 0; sprite < 64; sprite++) { //max of 64 sprites
-		//get y position of sprite
-		s16 y = vdp->vram[sat_base_addr + sprite];
-							  //when sprite y is 0xD0
-		if (y == 0xD0) break; //sprites not drawn in 192 line display mode if y == 0xD0
-		
+	for (u8 entry = 0; entry < sprite_count; entry++) {
+		u8 sprite = vdp->line_sprites[line][entry];
+
+		s16 y = vdp->sprite_y[sprite];
 		if (y > 192) y -= 0x100; //wrap when top part of sprite is off screen
 		y++;//y position is always y + 1
 
-		//Is sprite in range of visible display
-		if ((line >= y) && (line < (y + sprite_size))) {
-			sprite_count++;
-			if (sprite_count > 8) { //only 8 sprites per line allowed, set overflow
-				vdp->sprite_overflow = 1;
-				break;
-			}
+		s32 offset_to_x_coord = 128 + (sprite * 2);
+		s32 sprite_x = vdp->vram[sat_base_addr + offset_to_x_coord];
+		u16 pattern_index = vdp->vram[sat_base_addr + 1 + offset_to_x_coord];
 
-			s32 offset_to_x_coord = 128 + (sprite * 2);
-			s32 sprite_x = vdp->vram[sat_base_addr + offset_to_x_coord];
-			u16 pattern_index = vdp->vram[sat_base_addr + 1 + offset_to_x_coord];
+		if (shift_sprites_left) sprite_x -= 8;
+		if (use_second_pattern) pattern_index += 256;
 
-			if (shift_sprites_left) sprite_x -= 8;
-			if (use_second_pattern) pattern_index += 256;
+		if (is_sprite_8x16) {
+			//bit 0 of pattern index ignored
+			if(y < (line + 9))
+				pattern_index &= ~0x1;
+		}
 
-			if (is_sprite_8x16) {
-				//bit 0 of pattern index ignored
-				if(y < (line + 9))
-					pattern_index &= ~0x1;
-			}
+		//each sprite tile takes 32 bytes in memory
+		//(4 bytes per line)
+		pattern_index *= 32;
+
+		//get mem location for current line being drawn
+		//of tile, each line is 4 bytes
+		pattern_index += (4 * (line - y));
+
+		//the lower half of 8x16 sprites is the next pattern in vram
+		u16 pattern = (pattern_index / PATTERN_SIZE) % PATTERN_COUNT;
+		u8 pattern_row = (pattern_index / 4) % 8;
+
+		//opaque pixels of the row that are on screen, column 0 is never drawn
+		u8 visible = vdp->pattern_opaque[pattern][0][pattern_row];
+		if (sprite_x < 8)
+			visible &= (sprite_x <= 0) ? 0 : (0xFF << (8 - sprite_x));
+		else if (sprite_x > DISPLAY_WIDTH - 8)
+			visible &= 0xFF >> (sprite_x - (DISPLAY_WIDTH - 8));
+		if (!visible) continue;
+
+		//dont draw if bg has priority over sprite, pixels landing
+		//on an earlier sprite are a collision and arent drawn
+		visible &= ~vdpLineMaskGet(vdp->priority_mask, sprite_x);
+		u8 drawn = vdpLineMaskGet(sprites_drawn, sprite_x);
+		if (visible & drawn)
+			vdp->sprite_collision = 1;
+
+		u8 draw = visible & ~drawn;
+		vdpLineMaskSet(sprites_drawn, sprite_x, draw);
+
+		if (vdp->frame_render_mode == RenderFull) {
+			const u8* pattern_line = &vdp->pattern_cache[pattern][0][pattern_row * 8];
+			vdp->pattern_cache_hits++;
+			vdpKernels.sprite_row(pattern_line, draw, &vdp->line_buffer[sprite_x]);
+		}
+	}
+}
 
-			//each sprite tile takes 32 bytes in memory
-			//(4 bytes per line)
-			pattern_index *= 32;
-
-			//get mem location for current line being drawn
-			//of tile, each line is 4 bytes
-			pattern_index += (4 * (line - y));
-			
-
-			//get pattern line data
-			u8 d1 = vdp->vram[pattern_index];
-			u8 d2 = vdp->vram[pattern_index + 1];
-			u8 d3 = vdp->vram[pattern_index + 2];
-			u8 d4 = vdp->vram[pattern_index + 3];
-
-			//render 8 pixels for current tile line
-			for (s32 i = 0; i < 8; i++) {
-				s32 x_idx = i + sprite_x;
-
-				if (x_idx >= DISPLAY_WIDTH) break; //skip if off screen
-				if (x_idx < 8) continue; //skip if column 0
-				if (vdp->priority_buffer[x_idx]) continue; //dont draw if bg has priority over sprite
-
-				//Get which palette for this pattern line
-				u8 palette = testBit(d4, 7 - i) << 3;
-				palette |= testBit(d3, 7 - i) << 2;
-				palette |= testBit(d2, 7 - i) << 1;
-				palette |= testBit(d1, 7 - i);
-
-				//transparent
-				if (palette == 0) continue;
-
-				if (sprites_drawn[x_idx]) {
-					vdp->sprite_collision = 1;
-					continue;
-				}
+void vdpSetRenderMode(struct Vdp* vdp, enum VdpRenderMode mode)
+{
+	vdpCatchUp(vdp);
+	vdp->render_mode = mode;
+	vdpUpdateFrameRenderMode(vdp);
+}
+
+//Pixels are only made here when nothing else asked for status only,
+//a worker thread draws the pixels itself
+void vdpUpdateFrameRenderMode(struct Vdp* vdp)
+{
+	if (vdp->render_mode == RenderStatusOnly || vdp->frame_skipped || vdp->worker != NULL)
+		vdp->frame_render_mode = RenderStatusOnly;
+	else
+		vdp->frame_render_mode = RenderFull;
+}
+
+//Skips drawing skip frames out of every period, starting with the next frame.
+//Sprite overflow and collision are still set on skipped frames
+void vdpSetFrameSkip(struct Vdp* vdp, u8 skip, u8 period)
+{
+	vdp->frame_skip = skip;
+	vdp->frame_skip_period = period;
+}
+
+void vdpPrintFrameStats(struct Vdp* vdp)
+{
+	printf("frame %llu %s, %llu rendered %llu skipped\n", vdp->frame_count - 1,
+		vdp->last_frame_skipped ? "skipped" : "rendered", vdp->frames_rendered, vdp->frames_skipped);
+}
+
+//8 bits of a line mask from pixel x, pixels past the right edge read as 0
+u8 vdpLineMaskGet(const u64* mask, u16 x)
+{
+	u8 word = x >> 6;
+	u8 shift = x & 0x3F;
 
-				sprites_drawn[x_idx] = 1;
+	u64 bits = mask[word] >> shift;
+	if (shift > 56 && word + 1 < LINE_MASK_WORDS)
+		bits |= mask[word + 1] << (64 - shift);
+	return bits & 0xFF;
+}
 
-				u8 color = vdp->cram[palette + 16]; //sprites use second palette area
+//Sets 8 bits of a line mask from pixel x, bits past the right edge are dropped
+void vdpLineMaskSet(u64* mask, u16 x, u8 bits)
+{
+	u8 word = x >> 6;
+	u8 shift = x & 0x3F;
 
-				u8 red = color & 0x3;
-				u8 green = (color >> 2) & 0x3;
-				u8 blue = (color >> 4) & 0x3;
+	mask[word] |= (u64)bits << shift;
+	if (shift > 56 && word + 1 < LINE_MASK_WORDS)
+		mask[word + 1] |= (u64)bits >> (64 - shift);
+}
+
+void vdpLoadSpriteY(struct Vdp* vdp)
+{
+	u16 sat_base_addr = vdpGetSpriteAttributeTableBaseAddress(vdp);
+	memcpy(vdp->sprite_y, &vdp->vram[sat_base_addr], SPRITE_COUNT);
+	vdp->sprite_lines_dirty = 1;
+}
+
+//Keeps the cached y positions in step with vram writes
+void vdpWriteSpriteY(struct Vdp* vdp, u16 address, u8 value)
+{
+	u16 sat_base_addr = vdpGetSpriteAttributeTableBaseAddress(vdp);
+	if (address >= sat_base_addr && address < sat_base_addr + SPRITE_COUNT) {
+		vdp->sprite_y[address - sat_base_addr] = value;
+		vdp->sprite_lines_dirty = 1;
+	}
+}
+
+//Puts every sprite on the lines it covers, evaluated the way the
+//vdp scans the sprite attribute table for each line
+void vdpUpdateSpriteLines(struct Vdp* vdp)
+{
+	if (!vdp->sprite_lines_dirty)
+		return;
 
-				sfImage_setPixel(vdp->pixels, x_idx, line, vdpGetColor(red, green, blue));
+	vdp->sprite_lines_dirty = 0;
+	memset(vdp->line_sprite_count, 0x0, DISPLAY_HEIGHT);
+
+	u8 is_sprite_8x16 = (vdp->registers[1] >> 1) & 0x1;
+	u8 is_sprite_doubled = (vdp->registers[1] & 0x1);
+	u8 sprite_size = 8;
+	if (is_sprite_8x16 || is_sprite_doubled)
+		sprite_size = 16;
+
+	for (u8 sprite = 0; sprite < SPRITE_COUNT; sprite++) {
+		s16 y = vdp->sprite_y[sprite];
+		if (y == 0xD0) break; //sprites not drawn in 192 line display mode if y == 0xD0
+
+		if (y > 192) y -= 0x100; //wrap when top part of sprite is off screen
+		y++;//y position is always y + 1
+
+		s16 first_line = (y < 0) ? 0 : y;
+		s16 last_line = y + sprite_size;
+		if (last_line > DISPLAY_HEIGHT)
+			last_line = DISPLAY_HEIGHT;
+
+		for (s16 line = first_line; line < last_line; line++) {
+			//the first sprite past the limit is kept to flag the overflow
+			u8 count = vdp->line_sprite_count[line];
+			if (count <= SPRITES_PER_LINE) {
+				vdp->line_sprites[line][count] = sprite;
+				vdp->line_sprite_count[line] = count + 1;
 			}
 		}
 	}
 }
 
+void vdpOutputLine(struct Vdp* vdp)
+{
+	u32* line = &vdp->pixels[vdp->vcounter * vdp->pixel_stride];
+	vdpKernels.colors_to_pixels(vdp->line_buffer, vdp->palette, line, DISPLAY_WIDTH);
+}
+
 void vdpSetMode(struct Vdp* vdp)
 {
 	u8 mode = (vdp->registers[0] >> 2) & 0x1;
@@ -389,7 +622,116 @@ void vdpSetMode(struct Vdp* vdp)
 
 void vdpBufferPixels(struct Vdp* vdp)
 {
-	sfTexture_updateFromImage(vdp->framebuffer, vdp->pixels, 0, 0);
+	vdpCatchUp(vdp);
+
+	//nothing was drawn for a skipped frame
+	if (vdp->last_frame_skipped)
+		return;
+
+	if (vdp->worker != NULL)
+		vdpWorkerSync(vdp->worker);
+
+	//sfTexture only takes rgba, other formats are read by the caller
+	if (vdp->framebuffer == NULL || vdp->pixel_format != PixelRgba)
+		return;
+
+	if (vdp->pixel_stride == DISPLAY_WIDTH) {
+		sfTexture_updateFromPixels(vdp->framebuffer, (const sfUint8*)vdp->pixels,
+			DISPLAY_WIDTH, DISPLAY_HEIGHT, 0, 0);
+		return;
+	}
+	for (u16 y = 0; y < DISPLAY_HEIGHT; y++) {
+		sfTexture_updateFromPixels(vdp->framebuffer, (const sfUint8*)&vdp->pixels[y * vdp->pixel_stride],
+			DISPLAY_WIDTH, 1, 0, y);
+	}
+}
+
+//Renders into pixels from now on, a NULL buffer goes back to the vdp's own.
+//The buffer needs room for DISPLAY_HEIGHT lines of stride pixels
+void vdpSetFramebuffer(struct Vdp* vdp, u32* pixels, u32 stride, enum VdpPixelFormat format)
+{
+	//the worker could still be drawing into the old framebuffer
+	vdpCatchUp(vdp);
+	if (vdp->worker != NULL)
+		vdpWorkerSync(vdp->worker);
+
+	if (pixels == NULL) {
+		pixels = vdp->owned_pixels;
+		stride = DISPLAY_WIDTH;
+	}
+	vdp->pixels = pixels;
+	vdp->pixel_stride = stride;
+	vdp->pixel_format = format;
+	vdpRefreshPalette(vdp);
+
+	//start from opaque black like the display does
+	if (pixels != NULL) {
+		u32 black = 0xFF000000; //alpha is the top byte in both formats
+		for (u16 y = 0; y < DISPLAY_HEIGHT; y++) {
+			for (u16 x = 0; x < DISPLAY_WIDTH; x++)
+				pixels[(y * stride) + x] = black;
+		}
+	}
+
+	if (vdp->worker != NULL)
+		vdpWorkerSetFramebuffer(vdp->worker);
+}
+
+//Frame as last rendered, valid until the next line is drawn
+const u32* vdpGetFramebuffer(struct Vdp* vdp, u32* stride)
+{
+	vdpCatchUp(vdp);
+	if (vdp->worker != NULL)
+		vdpWorkerSync(vdp->worker);
+
+	if (stride != NULL)
+		*stride = vdp->pixel_stride;
+	return vdp->pixels;
+}
+
+void vdpMarkPatternDirty(struct Vdp* vdp, u16 address)
+{
+	u16 pattern = (address / PATTERN_SIZE) % PATTERN_COUNT;
+	if (!vdp->pattern_dirty[pattern]) {
+		vdp->pattern_dirty[pattern] = 1;
+		vdp->dirty_patterns[vdp->dirty_pattern_count++] = pattern;
+	}
+}
+
+void vdpDecodePattern(struct Vdp* vdp, u16 pattern)
+{
+	//each pattern line is 4 bitplanes, bit 7 is the leftmost pixel
+	const u8* planes = &vdp->vram[pattern * PATTERN_SIZE];
+	vdpKernels.decode_pattern(planes, vdp->pattern_cache[pattern][0], vdp->pattern_cache[pattern][1]);
+
+	//a pixel is opaque if any of its bitplanes are set
+	for (u8 y = 0; y < 8; y++) {
+		u8 opaque = planes[y * 4] | planes[(y * 4) + 1] | planes[(y * 4) + 2] | planes[(y * 4) + 3];
+		u8 reversed = 0;
+		for (u8 x = 0; x < 8; x++)
+			reversed |= ((opaque >> (7 - x)) & 0x1) << x;
+
+		vdp->pattern_opaque[pattern][0][y] = reversed;
+		vdp->pattern_opaque[pattern][1][y] = opaque;
+	}
+}
+
+void vdpUpdatePatternCache(struct Vdp* vdp)
+{
+	for (u16 i = 0; i < vdp->dirty_pattern_count; i++) {
+		u16 pattern = vdp->dirty_patterns[i];
+		vdpDecodePattern(vdp, pattern);
+		vdp->pattern_dirty[pattern] = 0;
+	}
+	vdp->pattern_cache_misses += vdp->dirty_pattern_count;
+	vdp->dirty_pattern_count = 0;
+}
+
+//8x8 palette indices of a pattern, used by the renderer and tile viewers
+const u8* vdpGetDecodedPattern(struct Vdp* vdp, u16 pattern, u8 horizontal_flip)
+{
+	vdpUpdatePatternCache(vdp);
+	return vdp->pattern_cache[pattern % PATTERN_COUNT][horizontal_flip & 0x1];
 }
 
 u8 vdpIsDisplayVisible(struct Vdp* vdp)
@@ -442,7 +784,14 @@ void vdpWriteControlPort(struct Vdp* vdp, u8 value)
 				u8 register_number = value & 0xF;
 
 				if (register_number < 0xB) {
+					vdpCatchUp(vdp);
 					vdp->registers[register_number] = data;
+
+					//sprite table moved or sprite size changed
+					if (register_number == 0x5)
+						vdpLoadSpriteY(vdp);
+					else if (register_number == 0x1)
+						vdp->sprite_lines_dirty = 1;
 				}
 
 				vdp->writes_to_vram = 1;
@@ -465,18 +814,22 @@ void vdpWriteControlPort(struct Vdp* vdp, u8 value)
 
 void vdpWriteDataPort(struct Vdp* vdp, u8 value)
 {
+	vdpCatchUp(vdp);
 	vdp->second_control_write = 0;
 	if (vdp->writes_to_vram) {
 		u16 address_reg = vdpGetAddressRegister(vdp);
 		vdp->vram[address_reg] = value;
+		vdpMarkPatternDirty(vdp, address_reg);
+		vdpWriteSpriteY(vdp, address_reg, value);
+		if (vdp->worker != NULL)
+			vdpWorkerLogWrite(vdp->worker, address_reg, value);
 
 		vdpIncrementAddressRegister(vdp);
 	}
 	else { //write to cram
 		u16 address_reg = vdpGetAddressRegister(vdp);
 		//cram is only 32 bytes
-		address_reg &= 0x1F;
-		vdp->cram[address_reg] = value;
+		vdpWriteCram(vdp, address_reg & 0x1F, value);
 
 		vdpIncrementAddressRegister(vdp);
 	}
@@ -484,8 +837,69 @@ void vdpWriteDataPort(struct Vdp* vdp, u8 value)
 	vdp->readbuffer = value;
 }
 
+//Same as count vdpWriteDataPort calls, vram is copied in runs up to the
+//point the address register wraps back to 0
+void vdpWriteDataPortBulk(struct Vdp* vdp, const u8* values, u16 count)
+{
+	if (count == 0)
+		return;
+
+	vdpCatchUp(vdp);
+	vdp->second_control_write = 0;
+	u16 address_reg = vdpGetAddressRegister(vdp);
+	if (vdp->writes_to_vram) {
+		u16 written = 0;
+		while (written < count) {
+			u16 run = count - written;
+			if (run > 0x4000 - address_reg)
+				run = 0x4000 - address_reg;
+
+			memcpy(&vdp->vram[address_reg], &values[written], run);
+			for (u16 address = address_reg; address < address_reg + run; address += PATTERN_SIZE)
+				vdpMarkPatternDirty(vdp, address);
+			vdpMarkPatternDirty(vdp, address_reg + run - 1);
+
+			u16 sat_base_addr = vdpGetSpriteAttributeTableBaseAddress(vdp);
+			if (address_reg < sat_base_addr + SPRITE_COUNT && address_reg + run > sat_base_addr)
+				vdpLoadSpriteY(vdp);
+
+			if (vdp->worker != NULL)
+				vdpWorkerLogWrites(vdp->worker, address_reg, &values[written], run);
+			written += run;
+			address_reg = (address_reg + run) & 0x3FFF;
+		}
+	}
+	else { //write to cram
+		for (u16 i = 0; i < count; i++)
+			vdpWriteCram(vdp, (address_reg + i) & 0x1F, values[i]);
+
+		address_reg = (address_reg + count) & 0x3FFF;
+	}
+
+	//keep code register unchanged
+	vdp->vdp_control = (vdp->vdp_control & 0xC000) | address_reg;
+	vdp->readbuffer = values[count - 1];
+}
+
+void vdpWriteCram(struct Vdp* vdp, u8 address, u8 value)
+{
+	vdp->cram[address] = value;
+	vdp->palette[address] = vdpMasterPalette[vdp->pixel_format][value & 0x3F];
+	if (vdp->worker != NULL)
+		vdpWorkerLogWrite(vdp->worker, WORKER_CRAM_WRITE | address, value);
+}
+
+//Rebuilds the whole host palette, needed when the pixel format changes
+void vdpRefreshPalette(struct Vdp* vdp)
+{
+	for (u8 i = 0; i < 0x20; i++)
+		vdp->palette[i] = vdpMasterPalette[vdp->pixel_format][vdp->cram[i] & 0x3F];
+}
+
 u8 vdpReadControlPort(struct Vdp* vdp)
 {
+	//sprite flags of the lines drawn so far
+	vdpCatchUp(vdp);
 	vdp->second_control_write = 0;
 	vdp->status_flags = 0x1F;
 	vdp->status_flags |= (vdp->frame_int_pending << 7);
@@ -18,6 +18,16 @@
 #define DISPLAY_WIDTH 256
 #define DISPLAY_HEIGHT 192
 
+//a bit per pixel of a line, pixel x is bit (x % 64) of word (x / 64)
+#define LINE_MASK_WORDS (DISPLAY_WIDTH / 64)
+
+#define SPRITE_COUNT 64
+#define SPRITES_PER_LINE 8
+
+//512 patterns of 32 bytes fill the whole of vram
+#define PATTERN_COUNT 512
+#define PATTERN_SIZE 32
+
 enum VdpDisplayState {
 	Visible = 0,
 	HBlank,
@@ -29,16 +39,29 @@ enum VdpDisplayMode {
 	Mode2
 };
 
+enum VdpRenderMode {
+	RenderFull = 0,
+	RenderStatusOnly //sprite overflow and collision only, no pixels are written
+};
+
+//Byte order of framebuffer pixels in memory
+enum VdpPixelFormat {
+	PixelRgba, //what sfTexture takes
+	PixelBgra
+};
+
+extern const u32 vdpMasterPalette[2][64];
+
 struct Vdp {
 	u8 vram[0x4000];
 	u8 cram[0x20];
+	u32 palette[0x20]; //cram as framebuffer pixels, refreshed on cram writes
 
 	enum VdpDisplayState state;
 	enum vdpDisplayMode mode;
 
 	//Internal vdp registers
 	u8 registers[0xB];
-	u16 cycles;
 
 	//Vdp Ports
 	u16 vdp_control;
@@ -69,9 +92,58 @@ struct Vdp {
 	u8 sprite_collision;
 	u8 y_scroll;
 
-	u8 priority_buffer[DISPLAY_WIDTH]; //used for checking priority of sprites/tiles
+	//Current line as cram indices, turned into rgba pixels once background and
+	//sprites are drawn. The tile cut by fine x scroll is drawn past the right edge
+	//into the extra 8 entries and wrapped back to the left
+	u8 line_buffer[DISPLAY_WIDTH + 8];
+	u64 priority_mask[LINE_MASK_WORDS]; //background pixels drawn over sprites
+	enum VdpRenderMode render_mode; //mode asked for with vdpSetRenderMode
+	enum VdpRenderMode frame_render_mode; //mode the current frame is drawn in
+
+	//Frame skip, the first frame_skip frames out of every frame_skip_period
+	//are drawn in status only mode and never uploaded. A period of 0 draws every frame
+	u8 frame_skip;
+	u8 frame_skip_period;
+	u8 frame_skipped; //current frame
+	u8 last_frame_skipped; //frame that just completed
+	u64 frame_count; //frames completed
+	u64 frames_rendered;
+	u64 frames_skipped;
+
+	//Deferred rendering, lines that ended are only drawn by vdpCatchUp once
+	//something they depend on is about to change or the frame is finished
+	u8 deferred_render;
+	u16 pending_line; //first line not drawn yet
+	u16 pending_lines;
+	u64 catch_ups;
+	u64 lines_caught_up;
+
+	//Patterns decoded to 8x8 palette indices, as stored and horizontally flipped.
+	//Vertical flips read the rows in reverse. vram writes mark patterns dirty
+	//and they are decoded again before the next line is rendered
+	u8 pattern_cache[PATTERN_COUNT][2][64];
+	u8 pattern_opaque[PATTERN_COUNT][2][8]; //per row, bit x set where pixel x isnt palette 0
+	u8 pattern_dirty[PATTERN_COUNT];
+	u16 dirty_patterns[PATTERN_COUNT];
+	u16 dirty_pattern_count;
+	u64 pattern_cache_hits; //pattern lines drawn from the cache
+	u64 pattern_cache_misses; //patterns decoded again after a vram write
+
+	//Sprite y positions cached from the sprite attribute table, and the sprites
+	//on each line in table order. A line with one more than SPRITES_PER_LINE
+	//overflowed. Rebuilt before a line is drawn when sprite_lines_dirty is set
+	u8 sprite_y[SPRITE_COUNT];
+	u8 line_sprites[DISPLAY_HEIGHT][SPRITES_PER_LINE + 1];
+	u8 line_sprite_count[DISPLAY_HEIGHT];
+	u8 sprite_lines_dirty;
+
+	//Frame the renderer draws into, the vdp's own buffer unless
+	//vdpSetFramebuffer points it at one owned by the caller
+	u32* pixels;
+	u32 pixel_stride; //pixels from the start of one line to the next
+	enum VdpPixelFormat pixel_format;
+	u32* owned_pixels;
 
-	struct sfImage* pixels;
 	struct sfTexture* framebuffer;
 	struct sfSprite* frame;
 
@@ -79,27 +151,60 @@ struct Vdp {
 	u16 display_height;
 	u8 frame_complete;
 
+	struct VdpWorker* worker; //renders lines on another thread when set
+
 	struct Io* io;
 	struct System* sys;
+	struct Scheduler* sched;
 };
 
 void vdpInit(struct Vdp* vdp);
 void vdpFree(struct Vdp* vdp);
 void vdpConnectIo(struct Vdp *vdp, struct Io* io);
-void vdpUpdate(struct Vdp *vdp, u8 cycles);
-void vdpScanlineUpdate(struct Vdp* vdp);
+void vdpConnectScheduler(struct Vdp* vdp, struct Scheduler* sched);
+void vdpScheduleFrame(struct Vdp* vdp, u64 frame_start);
+void vdpScheduleLineIrq(struct Vdp* vdp, u64 line_start);
+
+//Scheduler event handlers
+void vdpLineEnd(void* user, u64 timestamp);
+void vdpLineIrq(void* user, u64 timestamp);
+void vdpVBlank(void* user, u64 timestamp);
+void vdpFrameEnd(void* user, u64 timestamp);
+void vdpScanlineUpdate(struct Vdp* vdp, u64 line_start);
 void vdpDisplayGraphics(struct Vdp* vdp, sfRenderWindow *window);
 void vdpRender(struct Vdp* vdp);
+void vdpRenderLine(struct Vdp* vdp);
+void vdpCatchUp(struct Vdp* vdp);
+void vdpSetDeferredRendering(struct Vdp* vdp, u8 enabled);
 void vdpRenderBackground(struct Vdp* vdp);
 void vdpRenderSprites(struct Vdp* vdp);
+void vdpLoadSpriteY(struct Vdp* vdp);
+void vdpWriteSpriteY(struct Vdp* vdp, u16 address, u8 value);
+void vdpUpdateSpriteLines(struct Vdp* vdp);
+void vdpOutputLine(struct Vdp* vdp);
+void vdpSetRenderMode(struct Vdp* vdp, enum VdpRenderMode mode);
+void vdpUpdateFrameRenderMode(struct Vdp* vdp);
+void vdpSetFrameSkip(struct Vdp* vdp, u8 skip, u8 period);
+void vdpPrintFrameStats(struct Vdp* vdp);
+u8 vdpLineMaskGet(const u64* mask, u16 x);
+void vdpLineMaskSet(u64* mask, u16 x, u8 bits);
 void vdpSetMode(struct Vdp* vdp);
 void vdpBufferPixels(struct Vdp* vdp);
+void vdpSetFramebuffer(struct Vdp* vdp, u32* pixels, u32 stride, enum VdpPixelFormat format);
+const u32* vdpGetFramebuffer(struct Vdp* vdp, u32* stride);
+void vdpMarkPatternDirty(struct Vdp* vdp, u16 address);
+void vdpDecodePattern(struct Vdp* vdp, u16 pattern);
+void vdpUpdatePatternCache(struct Vdp* vdp);
+const u8* vdpGetDecodedPattern(struct Vdp* vdp, u16 pattern, u8 horizontal_flip);
 u8 vdpIsDisplayVisible(struct Vdp* vdp);
 u8 vdpIsDisplayActive(struct Vdp* vdp);
 u8 vdpFrameComplete(struct Vdp* vdp);
 
 void vdpWriteControlPort(struct Vdp* vdp, u8 value);
 void vdpWriteDataPort(struct Vdp* vdp, u8 value);
+void vdpWriteDataPortBulk(struct Vdp* vdp, const u8* values, u16 count);
+void vdpWriteCram(struct Vdp* vdp, u8 address, u8 value);
+void vdpRefreshPalette(struct Vdp* vdp);
 u8 vdpReadControlPort(struct Vdp* vdp);
 u8 vdpReadDataPort(struct Vdp* vdp); 
 
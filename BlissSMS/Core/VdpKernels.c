@@ -0,0 +1,396 @@
+#include "VdpKernels.h"
+#include "Vdp.h"
+#include <time.h>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+#ifdef SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+struct VdpKernels vdpKernels;
+
+//byte x holds bit (7 - x) of the plane byte, bit 7 is the leftmost pixel
+static u64 vdpPlaneExpand[0x100];
+
+//Scalar
+
+static void vdpDecodePatternScalar(const u8* planes, u8* decoded, u8* flipped)
+{
+	for (u8 y = 0; y < 8; y++) {
+		const u8* line = &planes[y * 4];
+		u64 row = vdpPlaneExpand[line[0]] | (vdpPlaneExpand[line[1]] << 1)
+			| (vdpPlaneExpand[line[2]] << 2) | (vdpPlaneExpand[line[3]] << 3);
+
+		for (u8 x = 0; x < 8; x++) {
+			u8 palette = (row >> (x * 8)) & 0xFF;
+			decoded[(y * 8) + x] = palette;
+			flipped[(y * 8) + (7 - x)] = palette;
+		}
+	}
+}
+
+static void vdpTileRowScalar(const u8* indices, u8 palette_offset, u8* colors)
+{
+	for (u8 x = 0; x < 8; x++)
+		colors[x] = indices[x] + palette_offset;
+}
+
+static void vdpSpriteRowScalar(const u8* indices, u8 draw, u8* colors)
+{
+	for (u8 x = 0; x < 8; x++) {
+		if (draw & (1 << x))
+			colors[x] = indices[x] + 16; //sprites use second palette area
+	}
+}
+
+static void vdpColorsToPixelsScalar(const u8* colors, const u32* palette, u32* pixels, u32 count)
+{
+	for (u32 i = 0; i < count; i++)
+		pixels[i] = palette[colors[i] & 0x1F];
+}
+
+#ifdef SIMD_X86
+
+//SSE2
+
+SIMD_TARGET("sse2") static void vdpDecodePatternSse2(const u8* planes, u8* decoded, u8* flipped)
+{
+	//bit tested for each pixel of two pattern lines
+	const __m128i bits = _mm_set_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i bits_flipped = _mm_set_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+
+	for (u8 y = 0; y < 8; y += 2) {
+		__m128i row = _mm_setzero_si128();
+		__m128i row_flipped = _mm_setzero_si128();
+
+		for (u8 plane = 0; plane < 4; plane++) {
+			__m128i data = _mm_unpacklo_epi64(_mm_set1_epi8(planes[(y * 4) + plane]),
+				_mm_set1_epi8(planes[((y + 1) * 4) + plane]));
+			__m128i plane_bit = _mm_set1_epi8(1 << plane);
+
+			__m128i set = _mm_cmpeq_epi8(_mm_and_si128(data, bits), bits);
+			row = _mm_or_si128(row, _mm_and_si128(set, plane_bit));
+
+			set = _mm_cmpeq_epi8(_mm_and_si128(data, bits_flipped), bits_flipped);
+			row_flipped = _mm_or_si128(row_flipped, _mm_and_si128(set, plane_bit));
+		}
+		_mm_storeu_si128((__m128i*)&decoded[y * 8], row);
+		_mm_storeu_si128((__m128i*)&flipped[y * 8], row_flipped);
+	}
+}
+
+SIMD_TARGET("sse2") static void vdpTileRowSse2(const u8* indices, u8 palette_offset, u8* colors)
+{
+	__m128i index = _mm_loadl_epi64((const __m128i*)indices);
+	_mm_storel_epi64((__m128i*)colors, _mm_add_epi8(index, _mm_set1_epi8(palette_offset)));
+}
+
+SIMD_TARGET("sse2") static void vdpSpriteRowSse2(const u8* indices, u8 draw, u8* colors)
+{
+	//bit of the draw mask for each pixel, expanded to a byte mask
+	const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+	__m128i select = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8(draw), bits), bits);
+
+	__m128i index = _mm_loadl_epi64((const __m128i*)indices);
+	__m128i color = _mm_loadl_epi64((const __m128i*)colors);
+	color = _mm_or_si128(_mm_andnot_si128(select, color),
+		_mm_and_si128(select, _mm_add_epi8(index, _mm_set1_epi8(16))));
+	_mm_storel_epi64((__m128i*)colors, color);
+}
+
+//AVX2, tile and sprite rows are only 8 pixels so they use the SSE2 kernels.
+//SSE2 has no gather, so its palette lookup is the scalar one
+
+SIMD_TARGET("avx2") static void vdpDecodePatternAvx2(const u8* planes, u8* decoded, u8* flipped)
+{
+	//picks the plane byte of the line each output byte belongs to,
+	//lines 0 - 1 in the low lane and lines 2 - 3 in the high lane
+	const __m256i line_select = _mm256_setr_epi8(
+		0, 0, 0, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4, 4,
+		8, 8, 8, 8, 8, 8, 8, 8, 12, 12, 12, 12, 12, 12, 12, 12);
+	const __m256i bits = _mm256_setr_epi8(
+		-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+		-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	const __m256i bits_flipped = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+		1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+
+	//4 pattern lines per half
+	for (u8 half = 0; half < 2; half++) {
+		__m256i lines = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)&planes[half * 16]));
+		__m256i row = _mm256_setzero_si256();
+		__m256i row_flipped = _mm256_setzero_si256();
+
+		for (u8 plane = 0; plane < 4; plane++) {
+			__m256i data = _mm256_shuffle_epi8(lines, _mm256_add_epi8(line_select, _mm256_set1_epi8(plane)));
+			__m256i plane_bit = _mm256_set1_epi8(1 << plane);
+
+			__m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(data, bits), bits);
+			row = _mm256_or_si256(row, _mm256_and_si256(set, plane_bit));
+
+			set = _mm256_cmpeq_epi8(_mm256_and_si256(data, bits_flipped), bits_flipped);
+			row_flipped = _mm256_or_si256(row_flipped, _mm256_and_si256(set, plane_bit));
+		}
+		_mm256_storeu_si256((__m256i*)&decoded[half * 32], row);
+		_mm256_storeu_si256((__m256i*)&flipped[half * 32], row_flipped);
+	}
+}
+
+SIMD_TARGET("avx2") static void vdpColorsToPixelsAvx2(const u8* colors, const u32* palette, u32* pixels, u32 count)
+{
+	const __m256i index_mask = _mm256_set1_epi32(0x1F);
+
+	u32 i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&colors[i]));
+		index = _mm256_and_si256(index, index_mask);
+		_mm256_storeu_si256((__m256i*)&pixels[i], _mm256_i32gather_epi32((const int*)palette, index, 4));
+	}
+	vdpColorsToPixelsScalar(&colors[i], palette, &pixels[i], count - i);
+}
+
+#endif
+
+#ifdef SIMD_NEON
+
+//NEON
+
+static void vdpDecodePatternNeon(const u8* planes, u8* decoded, u8* flipped)
+{
+	static const u8 bit_order[8] = { 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01 };
+	static const u8 bit_order_flipped[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+	const uint8x8_t bits = vld1_u8(bit_order);
+	const uint8x8_t bits_flipped = vld1_u8(bit_order_flipped);
+
+	for (u8 y = 0; y < 8; y++) {
+		uint8x8_t row = vdup_n_u8(0);
+		uint8x8_t row_flipped = vdup_n_u8(0);
+
+		for (u8 plane = 0; plane < 4; plane++) {
+			uint8x8_t data = vdup_n_u8(planes[(y * 4) + plane]);
+			uint8x8_t plane_bit = vdup_n_u8(1 << plane);
+
+			row = vorr_u8(row, vand_u8(vtst_u8(data, bits), plane_bit));
+			row_flipped = vorr_u8(row_flipped, vand_u8(vtst_u8(data, bits_flipped), plane_bit));
+		}
+		vst1_u8(&decoded[y * 8], row);
+		vst1_u8(&flipped[y * 8], row_flipped);
+	}
+}
+
+static void vdpTileRowNeon(const u8* indices, u8 palette_offset, u8* colors)
+{
+	vst1_u8(colors, vadd_u8(vld1_u8(indices), vdup_n_u8(palette_offset)));
+}
+
+static void vdpSpriteRowNeon(const u8* indices, u8 draw, u8* colors)
+{
+	static const u8 bit_order[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+	uint8x8_t select = vtst_u8(vdup_n_u8(draw), vld1_u8(bit_order));
+
+	uint8x8_t index = vld1_u8(indices);
+	vst1_u8(colors, vbsl_u8(select, vadd_u8(index, vdup_n_u8(16)), vld1_u8(colors)));
+}
+
+static void vdpColorsToPixelsNeon(const u8* colors, const u32* palette, u32* pixels, u32 count)
+{
+	//palette split into a 32 byte table per channel byte
+	u8 planes[4][0x20];
+	for (u8 i = 0; i < 0x20; i++) {
+		for (u8 byte = 0; byte < 4; byte++)
+			planes[byte][i] = (palette[i] >> (byte * 8)) & 0xFF;
+	}
+	uint8x16x2_t tables[4];
+	for (u8 byte = 0; byte < 4; byte++) {
+		tables[byte].val[0] = vld1q_u8(planes[byte]);
+		tables[byte].val[1] = vld1q_u8(&planes[byte][16]);
+	}
+
+	u32 i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint8x16_t index = vandq_u8(vld1q_u8(&colors[i]), vdupq_n_u8(0x1F));
+
+		uint8x16x4_t pixel_bytes;
+		for (u8 byte = 0; byte < 4; byte++)
+			pixel_bytes.val[byte] = vqtbl2q_u8(tables[byte], index);
+		vst4q_u8((u8*)&pixels[i], pixel_bytes);
+	}
+	vdpColorsToPixelsScalar(&colors[i], palette, &pixels[i], count - i);
+}
+
+#endif
+
+void vdpKernelsInit(void)
+{
+	for (u32 value = 0; value < 0x100; value++) {
+		u64 expanded = 0;
+		for (u8 x = 0; x < 8; x++) {
+			if (testBit(value, 7 - x))
+				expanded |= (u64)1 << (x * 8);
+		}
+		vdpPlaneExpand[value] = expanded;
+	}
+
+	//pick the fastest supported set
+	for (s32 type = SimdCount - 1; type >= SimdScalar; type--) {
+		if (vdpKernelsSelect(type))
+			break;
+	}
+}
+
+u8 vdpKernelsSelect(enum SimdType type)
+{
+	if (!simdSupported(type))
+		return 0;
+
+	struct VdpKernels kernels = { SimdScalar, "scalar", vdpDecodePatternScalar,
+		vdpTileRowScalar, vdpSpriteRowScalar, vdpColorsToPixelsScalar };
+
+	switch (type) {
+#ifdef SIMD_X86
+		case SimdSse2: {
+			struct VdpKernels sse2 = { SimdSse2, "sse2", vdpDecodePatternSse2,
+				vdpTileRowSse2, vdpSpriteRowSse2, vdpColorsToPixelsScalar };
+			kernels = sse2;
+		}
+		break;
+		case SimdAvx2: {
+			struct VdpKernels avx2 = { SimdAvx2, "avx2", vdpDecodePatternAvx2,
+				vdpTileRowSse2, vdpSpriteRowSse2, vdpColorsToPixelsAvx2 };
+			kernels = avx2;
+		}
+		break;
+#endif
+#ifdef SIMD_NEON
+		case SimdNeon: {
+			struct VdpKernels neon = { SimdNeon, "neon", vdpDecodePatternNeon,
+				vdpTileRowNeon, vdpSpriteRowNeon, vdpColorsToPixelsNeon };
+			kernels = neon;
+		}
+		break;
+#endif
+		default: break;
+	}
+	vdpKernels = kernels;
+	return 1;
+}
+
+//Benchmark
+
+#define BENCH_LINES 20000
+
+static u64 vdpBenchTime(void)
+{
+#ifdef SIMD_X86
+	return __rdtsc();
+#else
+	return (u64)clock() * (1000000000ull / CLOCKS_PER_SEC);
+#endif
+}
+
+//The renderer before the kernels: every pixel decoded from
+//its bitplanes and converted with vdpGetColor
+static u64 vdpBenchPerPixel(const u8* vram, const u8* cram, u32* pixels)
+{
+	u64 start = vdpBenchTime();
+	for (u32 line = 0; line < BENCH_LINES; line++) {
+		for (u32 column = 0; column < 32; column++) {
+			const u8* planes = &vram[(((line * 32) + column) % 512) * 32 + ((line % 8) * 4)];
+			for (u8 x = 0; x < 8; x++) {
+				u8 palette = testBit(planes[3], 7 - x) << 3;
+				palette |= testBit(planes[2], 7 - x) << 2;
+				palette |= testBit(planes[1], 7 - x) << 1;
+				palette |= testBit(planes[0], 7 - x);
+
+				u8 color = cram[palette];
+				sfColor rgba = vdpGetColor(color & 0x3, (color >> 2) & 0x3, (color >> 4) & 0x3);
+				pixels[(column * 8) + x] = rgba.r | (rgba.g << 8) | (rgba.b << 16) | ((u32)rgba.a << 24);
+			}
+		}
+	}
+	return vdpBenchTime() - start;
+}
+
+void vdpKernelsBenchmark(void)
+{
+	static u8 vram[0x4000];
+	static u8 decoded[64], flipped[64];
+	u8 cram[0x20];
+	u32 palette[0x20];
+	u8 colors[DISPLAY_WIDTH];
+	u32 pixels[DISPLAY_WIDTH];
+
+	srand(1);
+	for (u32 i = 0; i < 0x4000; i++)
+		vram[i] = rand() & 0xFF;
+	for (u32 i = 0; i < 0x20; i++)
+		cram[i] = rand() & 0x3F;
+	for (u32 i = 0; i < 0x20; i++)
+		palette[i] = vdpMasterPalette[PixelRgba][cram[i]];
+
+	enum SimdType selected = vdpKernels.type;
+
+#ifdef SIMD_X86
+	const char* unit = "cycles";
+#else
+	const char* unit = "ns";
+#endif
+	printf("VDP kernel benchmark, %s per scanline over %d lines\n", unit, BENCH_LINES);
+	printf("%-10s %10s %10s %10s %10s %10s\n", "kernels", "decode", "tiles", "sprites", "pixels", "total");
+
+	u64 per_pixel = vdpBenchPerPixel(vram, cram, pixels) / BENCH_LINES;
+	printf("%-10s %10s %10s %10s %10s %10llu\n", "per pixel", "-", "-", "-", "-", per_pixel);
+
+	u32 checksum = pixels[0];
+	for (s32 type = SimdScalar; type < SimdCount; type++) {
+		if (!vdpKernelsSelect(type))
+			continue;
+
+		//a line needs 32 pattern lines, 4 patterns worth when all are dirty
+		u64 start = vdpBenchTime();
+		for (u32 line = 0; line < BENCH_LINES; line++) {
+			for (u32 pattern = 0; pattern < 4; pattern++)
+				vdpKernels.decode_pattern(&vram[(((line * 4) + pattern) % 512) * 32], decoded, flipped);
+		}
+		u64 decode = (vdpBenchTime() - start) / BENCH_LINES;
+
+		start = vdpBenchTime();
+		for (u32 line = 0; line < BENCH_LINES; line++) {
+			for (u32 column = 0; column < 32; column++)
+				vdpKernels.tile_row(&vram[((line + column) % 2048) * 8], (column & 0x1) << 4,
+					&colors[column * 8]);
+		}
+		u64 tiles = (vdpBenchTime() - start) / BENCH_LINES;
+
+		//8 sprites, the most a line can show
+		start = vdpBenchTime();
+		for (u32 line = 0; line < BENCH_LINES; line++) {
+			for (u32 sprite = 0; sprite < 8; sprite++)
+				vdpKernels.sprite_row(&vram[((line + sprite) % 2048) * 8], vram[((line * 8) + sprite) % 0x4000],
+					&colors[sprite * 24]);
+		}
+		u64 sprites = (vdpBenchTime() - start) / BENCH_LINES;
+
+		start = vdpBenchTime();
+		for (u32 line = 0; line < BENCH_LINES; line++) {
+			colors[line % DISPLAY_WIDTH] = line & 0x1F;
+			vdpKernels.colors_to_pixels(colors, palette, pixels, DISPLAY_WIDTH);
+		}
+		u64 lookup = (vdpBenchTime() - start) / BENCH_LINES;
+
+		checksum += decoded[7] + flipped[7] + pixels[DISPLAY_WIDTH - 1];
+		printf("%-10s %10llu %10llu %10llu %10llu %10llu\n", vdpKernels.name,
+			decode, tiles, sprites, lookup, decode + tiles + sprites + lookup);
+	}
+	printf("checksum %08X\n", checksum);
+
+	vdpKernelsSelect(selected);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "Util.h"
+
+//Inner loops of the vdp renderer with scalar, SSE2, AVX2 and NEON versions.
+//The fastest set the host cpu supports is picked when the vdp is initialised,
+//every set produces exactly the same output as the scalar one.
+
+struct VdpKernels {
+	enum SimdType type;
+	const char* name;
+
+	//32 byte planar pattern to 8x8 palette indices, as stored and horizontally flipped
+	void (*decode_pattern)(const u8* planes, u8* decoded, u8* flipped);
+	//8 background pixels to cram indices
+	void (*tile_row)(const u8* indices, u8 palette_offset, u8* colors);
+	//8 sprite pixels to cram indices, only pixel x where bit x of draw is set
+	void (*sprite_row)(const u8* indices, u8 draw, u8* colors);
+	//cram indices to framebuffer pixels through the host palette
+	void (*colors_to_pixels)(const u8* colors, const u32* palette, u32* pixels, u32 count);
+};
+
+extern struct VdpKernels vdpKernels;
+
+void vdpKernelsInit(void);
+u8 vdpKernelsSelect(enum SimdType type);
+void vdpKernelsBenchmark(void);
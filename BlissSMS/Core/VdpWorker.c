@@ -0,0 +1,191 @@
+#include "VdpWorker.h"
+
+static void vdpWorkerBackoff(u32* spins)
+{
+	if (*spins < WORKER_SPIN_LIMIT) {
+		(*spins)++;
+		return;
+	}
+	sfSleep(sfMicroseconds(100));
+}
+
+static void vdpWorkerReplayLine(struct VdpWorker* worker, const struct VdpLineSnapshot* snapshot)
+{
+	struct Vdp* vdp = &worker->renderer;
+
+	u32 write = worker->writes_done;
+	for (; write != snapshot->write_end; write++) {
+		const struct VdpWrite* entry = &worker->writes[write % WORKER_WRITE_QUEUE_SIZE];
+		if (entry->address & WORKER_CRAM_WRITE) {
+			u8 address = entry->address & 0x1F;
+			vdp->cram[address] = entry->value;
+			vdp->palette[address] = vdpMasterPalette[vdp->pixel_format][entry->value & 0x3F];
+		}
+		else {
+			vdp->vram[entry->address] = entry->value;
+			vdpMarkPatternDirty(vdp, entry->address);
+			vdpWriteSpriteY(vdp, entry->address, entry->value);
+		}
+	}
+	atomicStore(&worker->writes_done, write);
+
+	if (!snapshot->render)
+		return;
+
+	//same checks as a register write through the control port
+	u8 sat_moved = vdp->registers[0x5] != snapshot->registers[0x5];
+	u8 size_changed = (vdp->registers[0x1] ^ snapshot->registers[0x1]) & 0x3;
+	memcpy(vdp->registers, snapshot->registers, 0xB);
+	if (sat_moved)
+		vdpLoadSpriteY(vdp);
+	else if (size_changed)
+		vdp->sprite_lines_dirty = 1;
+
+	vdp->y_scroll = snapshot->y_scroll;
+	vdp->vcounter = snapshot->line;
+	vdpRender(vdp);
+}
+
+static void vdpWorkerRun(void* user)
+{
+	struct VdpWorker* worker = (struct VdpWorker*)user;
+
+	u32 spins = 0;
+	while (1) {
+		u32 done = worker->lines_done;
+		if (done == atomicLoad(&worker->lines_pushed)) {
+			if (!atomicLoad(&worker->running))
+				break;
+			vdpWorkerBackoff(&spins);
+			continue;
+		}
+
+		spins = 0;
+		vdpWorkerReplayLine(worker, &worker->lines[done % WORKER_LINE_QUEUE_SIZE]);
+		atomicStore(&worker->lines_done, done + 1);
+	}
+}
+
+//Moves rendering of vdp onto a new thread, the worker starts
+//from a copy of the vdp as it is now
+u8 vdpWorkerStart(struct Vdp* vdp)
+{
+	if (vdp->worker != NULL)
+		return 1;
+
+	//lines still pending are drawn by the emulation thread
+	vdpCatchUp(vdp);
+
+	struct VdpWorker* worker = (struct VdpWorker*)malloc(sizeof(struct VdpWorker));
+	if (worker == NULL) {
+		printf("Failed to allocate the vdp worker\n");
+		return 0;
+	}
+
+	worker->vdp = vdp;
+	memcpy(&worker->renderer, vdp, sizeof(struct Vdp));
+	worker->renderer.render_mode = RenderFull;
+	worker->renderer.frame_render_mode = RenderFull;
+	worker->renderer.frame_skipped = 0;
+	worker->renderer.framebuffer = NULL;
+	worker->renderer.frame = NULL;
+	worker->renderer.owned_pixels = NULL;
+	worker->renderer.worker = NULL;
+	worker->renderer.io = NULL;
+	worker->renderer.sys = NULL;
+	worker->renderer.sched = NULL;
+
+	worker->lines_pushed = 0;
+	worker->lines_done = 0;
+	worker->writes_pushed = 0;
+	worker->writes_done = 0;
+	worker->running = 1;
+
+	worker->thread = sfThread_create(vdpWorkerRun, worker);
+	if (worker->thread == NULL) {
+		printf("Failed to create the vdp worker thread\n");
+		free(worker);
+		return 0;
+	}
+
+	vdp->worker = worker;
+	vdpUpdateFrameRenderMode(vdp);
+	sfThread_launch(worker->thread);
+	return 1;
+}
+
+//Finishes the queued lines and goes back to rendering on the emulation thread
+void vdpWorkerStop(struct Vdp* vdp)
+{
+	struct VdpWorker* worker = vdp->worker;
+	if (worker == NULL)
+		return;
+
+	vdpCatchUp(vdp);
+	vdpWorkerSync(worker);
+	atomicStore(&worker->running, 0);
+	sfThread_wait(worker->thread);
+	sfThread_destroy(worker->thread);
+
+	vdp->worker = NULL;
+	vdpUpdateFrameRenderMode(vdp);
+	free(worker);
+}
+
+//Waits until every line pushed so far is in the framebuffer
+void vdpWorkerSync(struct VdpWorker* worker)
+{
+	u32 spins = 0;
+	while (atomicLoad(&worker->lines_done) != worker->lines_pushed)
+		vdpWorkerBackoff(&spins);
+}
+
+void vdpWorkerPushLine(struct VdpWorker* worker, u8 render)
+{
+	u32 spins = 0;
+	while (worker->lines_pushed - atomicLoad(&worker->lines_done) >= WORKER_LINE_QUEUE_SIZE)
+		vdpWorkerBackoff(&spins);
+
+	struct Vdp* vdp = worker->vdp;
+	struct VdpLineSnapshot* snapshot = &worker->lines[worker->lines_pushed % WORKER_LINE_QUEUE_SIZE];
+	snapshot->write_end = worker->writes_pushed;
+	snapshot->line = vdp->vcounter;
+	memcpy(snapshot->registers, vdp->registers, 0xB);
+	snapshot->y_scroll = vdp->y_scroll;
+	snapshot->render = render;
+
+	atomicStore(&worker->lines_pushed, worker->lines_pushed + 1);
+}
+
+void vdpWorkerLogWrite(struct VdpWorker* worker, u16 address, u8 value)
+{
+	//writes are only replayed when a line is pushed, so a full queue pushes
+	//a line that isnt drawn and waits for the worker to replay it
+	if (worker->writes_pushed - atomicLoad(&worker->writes_done) >= WORKER_WRITE_QUEUE_SIZE) {
+		vdpWorkerPushLine(worker, 0);
+		vdpWorkerSync(worker);
+	}
+
+	struct VdpWrite* write = &worker->writes[worker->writes_pushed % WORKER_WRITE_QUEUE_SIZE];
+	write->address = address;
+	write->value = value;
+	worker->writes_pushed++;
+}
+
+void vdpWorkerLogWrites(struct VdpWorker* worker, u16 address, const u8* values, u16 count)
+{
+	for (u16 i = 0; i < count; i++)
+		vdpWorkerLogWrite(worker, (address + i) & 0x3FFF, values[i]);
+}
+
+//Points the worker at the framebuffer the vdp was given
+void vdpWorkerSetFramebuffer(struct VdpWorker* worker)
+{
+	vdpWorkerSync(worker);
+
+	struct Vdp* renderer = &worker->renderer;
+	renderer->pixels = worker->vdp->pixels;
+	renderer->pixel_stride = worker->vdp->pixel_stride;
+	renderer->pixel_format = worker->vdp->pixel_format;
+	vdpRefreshPalette(renderer);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Vdp.h"
+
+//Renders the display on a separate thread. The emulation thread logs vram
+//and cram writes and pushes the registers of each line drawn, the worker
+//replays them into its own copy of the vdp and draws the line into the
+//framebuffer. The emulation thread still renders every line in status only
+//mode so sprite overflow and collision are known straight away.
+
+#define WORKER_LINE_QUEUE_SIZE 256 //how many lines the worker can fall behind
+#define WORKER_WRITE_QUEUE_SIZE 0x8000
+#define WORKER_CRAM_WRITE 0x8000 //address flag for writes that go to cram
+
+//spins while waiting on the other thread before falling back to sleeping
+#define WORKER_SPIN_LIMIT 4096
+
+struct VdpLineSnapshot {
+	u32 write_end; //writes replayed before this line, up to this count
+	u16 line;
+	u8 registers[0xB];
+	u8 y_scroll;
+	u8 render; //0 when the worker only has to catch up on writes
+};
+
+struct VdpWrite {
+	u16 address;
+	u8 value;
+};
+
+struct VdpWorker {
+	struct Vdp* vdp; //the emulated vdp feeding the queues
+	struct Vdp renderer; //replayed copy, drawn by the worker thread
+
+	//Single producer, single consumer queues. Only the emulation thread moves
+	//the pushed counts and only the worker moves the done counts
+	struct VdpLineSnapshot lines[WORKER_LINE_QUEUE_SIZE];
+	volatile u32 lines_pushed;
+	volatile u32 lines_done;
+
+	struct VdpWrite writes[WORKER_WRITE_QUEUE_SIZE];
+	u32 writes_pushed; //published by the next line pushed
+	volatile u32 writes_done;
+
+	volatile u32 running;
+	sfThread* thread;
+};
+
+u8 vdpWorkerStart(struct Vdp* vdp);
+void vdpWorkerStop(struct Vdp* vdp);
+void vdpWorkerSync(struct VdpWorker* worker);
+void vdpWorkerPushLine(struct VdpWorker* worker, u8 render);
+void vdpWorkerLogWrite(struct VdpWorker* worker, u16 address, u8 value);
+void vdpWorkerLogWrites(struct VdpWorker* worker, u16 address, const u8* values, u16 count);
+void vdpWorkerSetFramebuffer(struct VdpWorker* worker);
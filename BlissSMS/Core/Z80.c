@@ -3,6 +3,18 @@
 #include "Io.h"
 #include "Vdp.h"
 #include "System.h"
+#include "Z80Opcodes.h"
+
+//Labels as values let the decoder jump straight into handler code
+#if defined(__GNUC__) || defined(__clang__)
+#define Z80_COMPUTED_GOTO
+#else
+static void z80BuildDispatchTables();
+#endif
+
+#if Z80_FLAG_TABLES
+static void z80BuildFlagTables();
+#endif
 
 void cpmLoadRom(struct Z80* z80, const char* path)
 {
@@ -57,6 +69,7 @@ u8 cpmReadMem8(struct Z80* z80, u16 address)
 
 void z80DebugOutput(struct Z80* z80)
 {
+	z80ResolveFlags(z80);
 	printf("PC: %04X, AF: %04X, BC: %04X, DE: %04X, HL: %04X, SP: %04X, "
 		"IX: %04X, IY: %04X, I: %02X, R: %02X Opcode: %02X %02X\n",
 		z80->pc, z80->af.value, z80->bc.value, z80->de.value, z80->hl.value, z80->sp,
@@ -112,9 +125,23 @@ void z80Init(struct Z80* z80)
 	z80->iff1 = 0;
 	z80->iff2 = 0;
 	z80->process_interrupt_delay = 0;
+	z80->irq_line_changed = 0;
+	z80->block_budget = 0;
+	z80->run_cycles = 0;
+	z80->idle_loop_armed = 0;
+	z80->halt_skipped_cycles = 0;
+	z80->idle_skipped_cycles = 0;
 	z80->halted = 0;
 	z80->last_daa_operation = 0;
 	z80->service_nmi = 0;
+	z80->flags_op = LazyNone;
+
+#ifndef Z80_COMPUTED_GOTO
+	z80BuildDispatchTables();
+#endif
+#if Z80_FLAG_TABLES
+	z80BuildFlagTables();
+#endif
 }
 
 void z80ConnectBus(struct Z80* z80, struct Bus* bus)
@@ -129,6 +156,7 @@ void z80ConnectIo(struct Z80* z80, struct Io* io)
 
 void z80AffectFlag(struct Z80* z80, u8 cond, u8 flags)
 {
+	z80ResolveFlags(z80);
 	if (cond) {
 		z80->af.lo |= (flags & 0b1101'0111);
 	}
@@ -139,11 +167,13 @@ void z80AffectFlag(struct Z80* z80, u8 cond, u8 flags)
 
 void z80SetFlag(struct Z80* z80, u8 flags)
 {
+	z80ResolveFlags(z80);
 	z80->af.lo |= (flags & 0b1101'0111);
 }
 
 void z80ClearFlag(struct Z80* z80, u8 flags)
 {
+	z80ResolveFlags(z80);
 	z80->af.lo &= ~(flags & 0b1101'0111);
 }
 
@@ -155,10 +185,141 @@ void z80ClearFlagCopyBits(struct Z80* z80)
 
 u8 getFlag(struct Z80* z80, u8 flag)
 {
+	if (z80->flags_op != LazyNone) {
+		//conditions mostly test a single flag, which can be answered
+		//straight from the deferred op without building all of F
+		switch (flag) {
+			case FLAG_Z: return (z80->flags_result == 0);
+			case FLAG_S: return z80IsSigned8(z80->flags_result);
+			case FLAG_C: {
+				switch (z80->flags_op) {
+					case LazyAdd8: return z80CarryOccured8(z80->flags_op1, z80->flags_op2, z80->flags_carry);
+					case LazySub8: return z80BorrowOccured8(z80->flags_op1, z80->flags_op2, z80->flags_carry);
+					case LazyAnd8: return 0;
+					default: return z80->flags_carry;
+				}
+			}
+		}
+		z80ResolveFlags(z80);
+	}
 	u8 mask = (z80->af.lo & flag);
 	return (mask ? 1 : 0);
 }
 
+void z80DeferFlags(struct Z80* z80, enum LazyFlagsOp op, u8 op1, u8 op2, u8 carry, u8 result)
+{
+	z80->flags_op = op;
+	z80->flags_op1 = op1;
+	z80->flags_op2 = op2;
+	z80->flags_carry = carry;
+	z80->flags_result = result;
+
+#if !Z80_LAZY_FLAGS
+	z80ResolveFlags(z80);
+#endif
+}
+
+//Builds the documented flags of a deferred alu op bit by bit through the flag helpers
+static u8 z80ComputeFlags(enum LazyFlagsOp op, u8 op1, u8 op2, u8 carry, u8 result)
+{
+	//every deferred op sets all documented flags, S and Z always come from the result
+	u8 flags = (result & FLAG_S);
+	if (result == 0) flags |= FLAG_Z;
+
+	switch (op) {
+		case LazyAdd8: {
+			if (z80HalfCarryOccured8(op1, op2, carry)) flags |= FLAG_H;
+			if (z80OverflowFromAdd8(op1, op2, carry)) flags |= FLAG_PV;
+			if (z80CarryOccured8(op1, op2, carry)) flags |= FLAG_C;
+		}break;
+		case LazySub8: {
+			flags |= FLAG_N;
+			if (z80HalfBorrowOccured8(op1, op2, carry)) flags |= FLAG_H;
+			if (z80OverflowFromSub8(op1, op2, carry)) flags |= FLAG_PV;
+			if (z80BorrowOccured8(op1, op2, carry)) flags |= FLAG_C;
+		}break;
+		case LazyInc8: {
+			if (z80HalfCarryOccured8(op1, 1, 0)) flags |= FLAG_H;
+			if (z80OverflowFromAdd8(op1, 1, 0)) flags |= FLAG_PV;
+			if (carry) flags |= FLAG_C;
+		}break;
+		case LazyDec8: {
+			flags |= FLAG_N;
+			if (z80HalfBorrowOccured8(op1, 1, 0)) flags |= FLAG_H;
+			if (z80OverflowFromSub8(op1, 1, 0)) flags |= FLAG_PV;
+			if (carry) flags |= FLAG_C;
+		}break;
+		case LazyAnd8: {
+			flags |= FLAG_H;
+			if (z80IsEvenParity(result)) flags |= FLAG_PV;
+		}break;
+		case LazyLogic8: {
+			if (z80IsEvenParity(result)) flags |= FLAG_PV;
+			if (carry) flags |= FLAG_C;
+		}break;
+		case LazyNone: break;
+	}
+	return flags;
+}
+
+#if Z80_FLAG_TABLES
+//add/sub flags are indexed by [carry in][op1][op2], the rest by result
+static u8 z80AddFlags[2][0x100][0x100];
+static u8 z80SubFlags[2][0x100][0x100];
+static u8 z80IncFlags[0x100];
+static u8 z80DecFlags[0x100];
+static u8 z80SzpFlags[0x100];
+
+static void z80BuildFlagTables()
+{
+	//tables are shared by every cpu instance and only need filling once
+	static u8 tables_built = 0;
+	if (tables_built)
+		return;
+
+	for (s32 carry = 0; carry < 2; carry++) {
+		for (s32 op1 = 0; op1 < 0x100; op1++) {
+			for (s32 op2 = 0; op2 < 0x100; op2++) {
+				z80AddFlags[carry][op1][op2] = z80ComputeFlags(LazyAdd8, op1, op2, carry, op1 + op2 + carry);
+				z80SubFlags[carry][op1][op2] = z80ComputeFlags(LazySub8, op1, op2, carry, op1 - op2 - carry);
+			}
+		}
+	}
+	//carry is left out of the result indexed tables and or'ed in on lookup
+	for (s32 result = 0; result < 0x100; result++) {
+		z80IncFlags[result] = z80ComputeFlags(LazyInc8, result - 1, 1, 0, result);
+		z80DecFlags[result] = z80ComputeFlags(LazyDec8, result + 1, 1, 0, result);
+		z80SzpFlags[result] = z80ComputeFlags(LazyLogic8, 0, 0, 0, result);
+	}
+	tables_built = 1;
+}
+#endif
+
+void z80ResolveFlags(struct Z80* z80)
+{
+	if (z80->flags_op == LazyNone)
+		return;
+
+#if Z80_FLAG_TABLES
+	u8 flags;
+	switch (z80->flags_op) {
+		case LazyAdd8: flags = z80AddFlags[z80->flags_carry][z80->flags_op1][z80->flags_op2]; break;
+		case LazySub8: flags = z80SubFlags[z80->flags_carry][z80->flags_op1][z80->flags_op2]; break;
+		case LazyInc8: flags = z80IncFlags[z80->flags_result] | z80->flags_carry; break;
+		case LazyDec8: flags = z80DecFlags[z80->flags_result] | z80->flags_carry; break;
+		case LazyAnd8: flags = z80SzpFlags[z80->flags_result] | FLAG_H; break;
+		case LazyLogic8: flags = z80SzpFlags[z80->flags_result] | z80->flags_carry; break;
+		default: return; //LazyNone has nothing to resolve
+	}
+#else
+	u8 flags = z80ComputeFlags(z80->flags_op, z80->flags_op1, z80->flags_op2,
+		z80->flags_carry, z80->flags_result);
+#endif
+
+	z80->af.lo = (z80->af.lo & ~0b1101'0111) | flags;
+	z80->flags_op = LazyNone;
+}
+
 void z80HandleInterrupts(struct Z80* z80, struct Vdp* vdp)
 {
 	//nmi has priority over maskable irqs
@@ -188,6 +349,7 @@ void z80HandleInterrupts(struct Z80* z80, struct Vdp* vdp)
 void z80RequestIrq(struct System* sys)
 {
 	sys->z80.irq_requested = 1;
+	sys->z80.irq_line_changed = 1;
 }
 
 u8 z80OverflowFromAdd8(u8 op1, u8 op2, u8 carry)
@@ -334,15 +496,18 @@ u16 z80FetchU16(struct Z80* z80)
 u16 z80Clock(struct Z80* z80)
 {
 	if (!z80->halted) {
-		if (z80->process_interrupt_delay)
+		//the instruction after ei runs before interrupts are checked again
+		if (z80->process_interrupt_delay) {
 			z80->process_interrupt_delay = 0;
+			z80->irq_line_changed = 1;
+		}
 
 		//Prelim test finished
 		if (z80->cpm_stub_enabled) {
 			cpmHandleSysCalls(z80);
 			if (z80->pc == 0) {
 				z80->halted = 1;
-				return;
+				return 0;
 			}
 		}
 		u8 opcode = z80ReadU8(z80, z80->pc);
@@ -356,1126 +521,256 @@ u16 z80Clock(struct Z80* z80)
 	return z80->cycles;
 }
 
-void executeInstruction(struct Z80* z80, u8 opcode)
+u32 z80Run(struct Z80* z80, s32 cycle_budget)
 {
-	z80->opcode = opcode;
-	switch (opcode) {
-	case 0xCB: {
-		u8 bit_opcode = z80ReadU8(z80, z80->pc++);
-		executeBitInstruction(z80, bit_opcode);
-	}
-			 break;
-	case 0xDD: {
-		u8 ix_opcode = z80ReadU8(z80, z80->pc++);
-		if (ix_opcode == 0xCB) {
-			//the opcode is the last byte in the instruction
-			//and the immediate byte to fetch is the second to last
-			u8 ixbit_opcode = z80ReadU8(z80, z80->pc + 1);
-
-			executeIxBitInstruction(z80, ixbit_opcode);
-			z80->pc += 1;
-		}
-		else
-			executeIxInstruction(z80, ix_opcode);
-	}
-			 break;
-	case 0xED: {
-		u8 ext_opcode = z80ReadU8(z80, z80->pc++);
-		z80->ext_opcode = ext_opcode;
-		executeExtendedInstruction(z80, ext_opcode);
-	}
-			 break;
-	case 0xFD: {
-		u8 iy_opcode = z80ReadU8(z80, z80->pc++);
-		if (iy_opcode == 0xCB) {
-			u8 iybit_opcode = z80ReadU8(z80, z80->pc + 1);
-
-			executeIyBitInstruction(z80, iybit_opcode);
-			z80->pc += 1;
+	u32 cycles = 0;
+	z80->idle_loop_armed = 0;
+
+	while ((s32)cycles < cycle_budget) {
+		//only an interrupt ends a halt and those are serviced between batches,
+		//so run out the budget in the same 4 cycle steps z80Clock would take
+		if (z80->halted && !z80->irq_line_changed) {
+			u32 skipped = ((cycle_budget - cycles + 3) / 4) * 4;
+			z80->halt_skipped_cycles += skipped;
+			z80->cycles = 4;
+			cycles += skipped;
+			break;
 		}
-		else
-			executeIyInstruction(z80, iy_opcode);
-	}
-			 break;
 
-	default:
-		executeMainInstruction(z80, opcode);
-		break;
+		u16 pc = z80->pc;
+		z80->block_budget = cycle_budget - cycles;
+		z80->run_cycles = cycles;
+		cycles += z80Clock(z80);
+
+		//stop early so the caller can service the new interrupt state
+		if (z80->irq_line_changed || z80->io->irq_line_changed)
+			break;
+
+		if (z80->pc < pc)
+			cycles += z80SkipIdleLoop(z80, pc, cycles, cycle_budget);
 	}
-	z80ClearFlagCopyBits(z80);
+	z80->irq_line_changed = 0;
+	z80->io->irq_line_changed = 0;
+	z80->block_budget = 0;
+	z80->run_cycles = 0;
+
+	return cycles;
 }
 
-void executeMainInstruction(struct Z80* z80, u8 opcode)
+//Keeps the cycles of a single block instruction call within z80->cycles
+#define MAX_BLOCK_ITERATIONS 3000
+
+//Number of repeats a block instruction runs in one call. It keeps going while
+//the z80Run budget allows and stops on the repeat that reaches it, exactly where
+//a batch of single repeats would have stopped
+u32 z80BlockIterations(struct Z80* z80, u32 count)
 {
-	switch (opcode) {
-	case 0x00: z80->cycles = 4; break;
-
-		//Load immediate u16 into register
-	case 0x01: loadReg16(z80, &z80->bc); break;
-	case 0x11: loadReg16(z80, &z80->de); break;
-	case 0x21: loadReg16(z80, &z80->hl); break;
-	case 0x31: loadReg16(z80, &z80->sp); break;
-	case 0xF9: loadSpReg(z80, &z80->hl); break;
-
-		//Misc
-	case 0x2F: cpl(z80); break;
-	case 0x76: halt(z80); break;
-	case 0xFE: cp(z80, z80FetchU8(z80)); z80->cycles += 3; break;
-	case 0x27: daa(z80); break;
-	case 0x3F: ccf(z80); break;
-	case 0x37: scf(z80); break;
-
-		//Shifts
-	case 0x07: rlca(z80); break;
-	case 0x0F: rrca(z80); break;
-	case 0x17: rla(z80); break;
-	case 0x1F: rra(z80); break;
-
-		//Exchanges
-	case 0x08: ex(z80, &z80->af, &z80->shadowedregs.af); break;
-	case 0xE3: ex(z80, &z80->sp, &z80->hl); break;
-	case 0xEB: ex(z80, &z80->de, &z80->hl); break;
-	case 0xD9: exx(z80); break;
-
-		//Loads
-
-		//Register pointer loads
-	case 0x0A: loadRegMem(z80, &z80->af.hi, &z80->bc); break;
-	case 0x1A: loadRegMem(z80, &z80->af.hi, &z80->de); break;
-	case 0x02: loadReg8Mem(z80, z80->bc, z80->af.hi); break;
-	case 0x12: loadReg8Mem(z80, z80->de, z80->af.hi); break;
-
-	case 0x22: loadMemReg16(z80, &z80->hl); break;
-	case 0x32: loadMemReg8(z80, z80->af.hi); break;
-
-	case 0x06: loadReg8(z80, &z80->bc.hi); break;
-	case 0x0E: loadReg8(z80, &z80->bc.lo); break;
-	case 0x16: loadReg8(z80, &z80->de.hi); break;
-	case 0x1E: loadReg8(z80, &z80->de.lo); break;
-	case 0x26: loadReg8(z80, &z80->hl.hi); break;
-	case 0x2E: loadReg8(z80, &z80->hl.lo); break;
-	case 0x3E: loadReg8(z80, &z80->af.hi); break;
-	case 0x36: loadHL8(z80); break;
-
-	case 0x2A: load16Reg(z80, &z80->hl); break;
-	case 0x3A: load16A(z80); break;
-
-		//Load src reg into dest reg
-	case 0x40: loadReg(z80, &z80->bc.hi, z80->bc.hi); break;
-	case 0x41: loadReg(z80, &z80->bc.hi, z80->bc.lo); break;
-	case 0x42: loadReg(z80, &z80->bc.hi, z80->de.hi); break;
-	case 0x43: loadReg(z80, &z80->bc.hi, z80->de.lo); break;
-	case 0x44: loadReg(z80, &z80->bc.hi, z80->hl.hi); break;
-	case 0x45: loadReg(z80, &z80->bc.hi, z80->hl.lo); break;
-	case 0x47: loadReg(z80, &z80->bc.hi, z80->af.hi); break;
-	case 0x48: loadReg(z80, &z80->bc.lo, z80->bc.hi); break;
-	case 0x49: loadReg(z80, &z80->bc.lo, z80->bc.lo); break;
-	case 0x4A: loadReg(z80, &z80->bc.lo, z80->de.hi); break;
-	case 0x4B: loadReg(z80, &z80->bc.lo, z80->de.lo); break;
-	case 0x4C: loadReg(z80, &z80->bc.lo, z80->hl.hi); break;
-	case 0x4D: loadReg(z80, &z80->bc.lo, z80->hl.lo); break;
-	case 0x4F: loadReg(z80, &z80->bc.lo, z80->af.hi); break;
-	case 0x50: loadReg(z80, &z80->de.hi, z80->bc.hi); break;
-	case 0x51: loadReg(z80, &z80->de.hi, z80->bc.lo); break;
-	case 0x52: loadReg(z80, &z80->de.hi, z80->de.hi); break;
-	case 0x53: loadReg(z80, &z80->de.hi, z80->de.lo); break;
-	case 0x54: loadReg(z80, &z80->de.hi, z80->hl.hi); break;
-	case 0x55: loadReg(z80, &z80->de.hi, z80->hl.lo); break;
-	case 0x57: loadReg(z80, &z80->de.hi, z80->af.hi); break;
-	case 0x58: loadReg(z80, &z80->de.lo, z80->bc.hi); break;
-	case 0x59: loadReg(z80, &z80->de.lo, z80->bc.lo); break;
-	case 0x5A: loadReg(z80, &z80->de.lo, z80->de.hi); break;
-	case 0x5B: loadReg(z80, &z80->de.lo, z80->de.lo); break;
-	case 0x5C: loadReg(z80, &z80->de.lo, z80->hl.hi); break;
-	case 0x5D: loadReg(z80, &z80->de.lo, z80->hl.lo); break;
-	case 0x5F: loadReg(z80, &z80->de.lo, z80->af.hi); break;
-	case 0x60: loadReg(z80, &z80->hl.hi, z80->bc.hi); break;
-	case 0x61: loadReg(z80, &z80->hl.hi, z80->bc.lo); break;
-	case 0x62: loadReg(z80, &z80->hl.hi, z80->de.hi); break;
-	case 0x63: loadReg(z80, &z80->hl.hi, z80->de.lo); break;
-	case 0x64: loadReg(z80, &z80->hl.hi, z80->hl.hi); break;
-	case 0x65: loadReg(z80, &z80->hl.hi, z80->hl.lo); break;
-	case 0x67: loadReg(z80, &z80->hl.hi, z80->af.hi); break;
-	case 0x68: loadReg(z80, &z80->hl.lo, z80->bc.hi); break;
-	case 0x69: loadReg(z80, &z80->hl.lo, z80->bc.lo); break;
-	case 0x6A: loadReg(z80, &z80->hl.lo, z80->de.hi); break;
-	case 0x6B: loadReg(z80, &z80->hl.lo, z80->de.lo); break;
-	case 0x6C: loadReg(z80, &z80->hl.lo, z80->hl.hi); break;
-	case 0x6D: loadReg(z80, &z80->hl.lo, z80->hl.lo); break;
-	case 0x6F: loadReg(z80, &z80->hl.lo, z80->af.hi); break;
-
-	case 0x78: loadAReg(z80, z80->bc.hi); break;
-	case 0x79: loadAReg(z80, z80->bc.lo); break;
-	case 0x7A: loadAReg(z80, z80->de.hi); break;
-	case 0x7B: loadAReg(z80, z80->de.lo); break;
-	case 0x7C: loadAReg(z80, z80->hl.hi); break;
-	case 0x7D: loadAReg(z80, z80->hl.lo); break;
-	case 0x7F: loadAReg(z80, z80->af.hi); break;
-
-	case 0x46: loadRegHl(z80, &z80->bc.hi); break;
-	case 0x4E: loadRegHl(z80, &z80->bc.lo); break;
-	case 0x56: loadRegHl(z80, &z80->de.hi); break;
-	case 0x5E: loadRegHl(z80, &z80->de.lo); break;
-	case 0x66: loadRegHl(z80, &z80->hl.hi); break;
-	case 0x6E: loadRegHl(z80, &z80->hl.lo); break;
-	case 0x7E: loadRegHl(z80, &z80->af.hi); break;
-
-	case 0x70: loadHlReg(z80, z80->bc.hi); break;
-	case 0x71: loadHlReg(z80, z80->bc.lo); break;
-	case 0x72: loadHlReg(z80, z80->de.hi); break;
-	case 0x73: loadHlReg(z80, z80->de.lo); break;
-	case 0x74: loadHlReg(z80, z80->hl.hi); break;
-	case 0x75: loadHlReg(z80, z80->hl.lo); break;
-	case 0x77: loadHlReg(z80, z80->af.hi); break;
-
-		//Arithmetic
-	case 0x19: addReg16(z80, &z80->hl, &z80->de); break;
-	case 0x09: addReg16(z80, &z80->hl, &z80->bc); break;
-	case 0x29: addReg16(z80, &z80->hl, &z80->hl); break;
-	case 0x39: addReg16(z80, &z80->hl, &z80->sp); break;
-
-	case 0x03: incReg16(z80, &z80->bc); break;
-	case 0x13: incReg16(z80, &z80->de); break;
-	case 0x23: incReg16(z80, &z80->hl); break;
-	case 0x33: incReg16(z80, &z80->sp); break;
-	case 0x0B: decReg16(z80, &z80->bc); break;
-	case 0x1B: decReg16(z80, &z80->de); break;
-	case 0x2B: decReg16(z80, &z80->hl); break;
-	case 0x3B: decReg16(z80, &z80->sp); break;
-	case 0x05: decReg8(z80, &z80->bc.hi); break;
-	case 0x15: decReg8(z80, &z80->de.hi); break;
-	case 0x25: decReg8(z80, &z80->hl.hi); break;
-	case 0x0D: decReg8(z80, &z80->bc.lo); break;
-	case 0x1D: decReg8(z80, &z80->de.lo); break;
-	case 0x2D: decReg8(z80, &z80->hl.lo); break;
-	case 0x3D: decReg8(z80, &z80->af.hi); break;
-	case 0x35: decMemHl(z80); break;
-
-	case 0x04: incReg8(z80, &z80->bc.hi); break;
-	case 0x0C: incReg8(z80, &z80->bc.lo); break;
-	case 0x14: incReg8(z80, &z80->de.hi); break;
-	case 0x1C: incReg8(z80, &z80->de.lo); break;
-	case 0x24: incReg8(z80, &z80->hl.hi); break;
-	case 0x2C: incReg8(z80, &z80->hl.lo); break;
-	case 0x3C: incReg8(z80, &z80->af.hi); break;
-	case 0x34: incMemHl(z80); break;
-
-		//8 bit reg add
-	case 0x80: addReg8(z80, &z80->af.hi, z80->bc.hi); break;
-	case 0x81: addReg8(z80, &z80->af.hi, z80->bc.lo); break;
-	case 0x82: addReg8(z80, &z80->af.hi, z80->de.hi); break;
-	case 0x83: addReg8(z80, &z80->af.hi, z80->de.lo); break;
-	case 0x84: addReg8(z80, &z80->af.hi, z80->hl.hi); break;
-	case 0x85: addReg8(z80, &z80->af.hi, z80->hl.lo); break;
-	case 0x86: addMemHl(z80, &z80->af.hi); break;
-	case 0x87: addReg8(z80, &z80->af.hi, z80->af.hi); break;
-	case 0xC6: addReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3; break;
-
-	case 0x88: adcReg8(z80, &z80->af.hi, z80->bc.hi); break;
-	case 0x89: adcReg8(z80, &z80->af.hi, z80->bc.lo); break;
-	case 0x8A: adcReg8(z80, &z80->af.hi, z80->de.hi); break;
-	case 0x8B: adcReg8(z80, &z80->af.hi, z80->de.lo); break;
-	case 0x8C: adcReg8(z80, &z80->af.hi, z80->hl.hi); break;
-	case 0x8D: adcReg8(z80, &z80->af.hi, z80->hl.lo); break;
-	case 0x8E: adcMemHl(z80, &z80->af.hi); break;
-	case 0x8F: adcReg8(z80, &z80->af.hi, z80->af.hi); break;
-	case 0xCE: adcReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3; break;
-
-		//8 bit reg sub
-	case 0x90: subReg8(z80, &z80->af.hi, z80->bc.hi); break;
-	case 0x91: subReg8(z80, &z80->af.hi, z80->bc.lo); break;
-	case 0x92: subReg8(z80, &z80->af.hi, z80->de.hi); break;
-	case 0x93: subReg8(z80, &z80->af.hi, z80->de.lo); break;
-	case 0x94: subReg8(z80, &z80->af.hi, z80->hl.hi); break;
-	case 0x95: subReg8(z80, &z80->af.hi, z80->hl.lo); break;
-	case 0x96: subMemHl(z80, &z80->af.hi); break;
-	case 0x97: subReg8(z80, &z80->af.hi, z80->af.hi); break;
-	case 0xD6: subReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3; break;
-
-	case 0x98: sbcReg8(z80, &z80->af.hi, z80->bc.hi); break;
-	case 0x99: sbcReg8(z80, &z80->af.hi, z80->bc.lo); break;
-	case 0x9A: sbcReg8(z80, &z80->af.hi, z80->de.hi); break;
-	case 0x9B: sbcReg8(z80, &z80->af.hi, z80->de.lo); break;
-	case 0x9C: sbcReg8(z80, &z80->af.hi, z80->hl.hi); break;
-	case 0x9D: sbcReg8(z80, &z80->af.hi, z80->hl.lo); break;
-	case 0x9E: sbcMemHl(z80, &z80->af.hi); break;
-	case 0x9F: sbcReg8(z80, &z80->af.hi, z80->af.hi); break;
-	case 0xDE: sbcReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3; break;
-
-		//Jumps/Branches/Rets
-	case 0x10: djnz(z80); break;
-	case 0x18: jrImm(z80); break;
-	case 0x20: jrImmCond(z80, getFlag(z80, FLAG_Z) == 0); break;
-	case 0x28: jrImmCond(z80, getFlag(z80, FLAG_Z)); break;
-	case 0x30: jrImmCond(z80, getFlag(z80, FLAG_C) == 0); break;
-	case 0x38: jrImmCond(z80, getFlag(z80, FLAG_C)); break;
-
-		//Logical
-	case 0xA0: and (z80, z80->bc.hi); break;
-	case 0xA1: and (z80, z80->bc.lo); break;
-	case 0xA2: and (z80, z80->de.hi); break;
-	case 0xA3: and (z80, z80->de.lo); break;
-	case 0xA4: and (z80, z80->hl.hi); break;
-	case 0xA5: and (z80, z80->hl.lo); break;
-	case 0xA6: andMemHl(z80); break;
-	case 0xA7: and (z80, z80->af.hi); break;
-	case 0xE6: and (z80, z80FetchU8(z80)); z80->cycles += 3; break;
-
-
-	case 0xA8: xor (z80, z80->bc.hi); break;
-	case 0xA9: xor (z80, z80->bc.lo); break;
-	case 0xAA: xor (z80, z80->de.hi); break;
-	case 0xAB: xor (z80, z80->de.lo); break;
-	case 0xAC: xor (z80, z80->hl.hi); break;
-	case 0xAD: xor (z80, z80->hl.lo); break;
-	case 0xAE: xorMemHl(z80); break;
-	case 0xAF: xor (z80, z80->af.hi); break;
-	case 0xEE: xor (z80, z80FetchU8(z80)); z80->cycles += 3; break;
-
-	case 0xB0: or (z80, z80->bc.hi); break;
-	case 0xB1: or (z80, z80->bc.lo); break;
-	case 0xB2: or (z80, z80->de.hi); break;
-	case 0xB3: or (z80, z80->de.lo); break;
-	case 0xB4: or (z80, z80->hl.hi); break;
-	case 0xB5: or (z80, z80->hl.lo); break;
-	case 0xB6: orMemHl(z80); break;
-	case 0xB7: or (z80, z80->af.hi); break;
-	case 0xF6: or (z80, z80FetchU8(z80)); z80->cycles += 3; break;
-
-	case 0xB8: cp(z80, z80->bc.hi); break;
-	case 0xB9: cp(z80, z80->bc.lo); break;
-	case 0xBA: cp(z80, z80->de.hi); break;
-	case 0xBB: cp(z80, z80->de.lo); break;
-	case 0xBC: cp(z80, z80->hl.hi); break;
-	case 0xBD: cp(z80, z80->hl.lo); break;
-	case 0xBE: cpMemHl(z80); break;
-	case 0xBF: cp(z80, z80->af.hi); break;
-
-	case 0xCC: callCond(z80, getFlag(z80, FLAG_Z)); break;
-	case 0xCD: call(z80); break;
-	case 0xC4: callCond(z80, getFlag(z80, FLAG_Z) == 0); break;
-	case 0xD4: callCond(z80, getFlag(z80, FLAG_C) == 0); break;
-	case 0xDC: callCond(z80, getFlag(z80, FLAG_C)); break;
-	case 0xE4: callCond(z80, getFlag(z80, FLAG_PV) == 0); break;
-	case 0xEC: callCond(z80, getFlag(z80, FLAG_PV)); break;
-	case 0xF4: callCond(z80, getFlag(z80, FLAG_S) == 0); break;
-	case 0xFC: callCond(z80, getFlag(z80, FLAG_S));  break;
-
-	case 0xC0: retCond(z80, getFlag(z80, FLAG_Z) == 0); break;
-	case 0xC8: retCond(z80, getFlag(z80, FLAG_Z)); break;
-	case 0xC9: ret(z80); break;
-	case 0xD0: retCond(z80, getFlag(z80, FLAG_C) == 0); break;
-	case 0xD8: retCond(z80, getFlag(z80, FLAG_C)); break;
-	case 0xE0: retCond(z80, getFlag(z80, FLAG_PV) == 0); break;
-	case 0xE8: retCond(z80, getFlag(z80, FLAG_PV)); break;
-	case 0xF0: retCond(z80, getFlag(z80, FLAG_S) == 0); break;
-	case 0xF8: retCond(z80, getFlag(z80, FLAG_S)); break;
-
-		//Jumps
-	case 0xC2: jpCond(z80, getFlag(z80, FLAG_Z) == 0); break;
-	case 0xC3: jp(z80); break;
-	case 0xCA: jpCond(z80, getFlag(z80, FLAG_Z)); break;
-	case 0xD2: jpCond(z80, getFlag(z80, FLAG_C) == 0); break;
-	case 0xDA: jpCond(z80, getFlag(z80, FLAG_C)); break;
-	case 0xE2: jpCond(z80, getFlag(z80, FLAG_PV) == 0); break;
-	case 0xE9: jpMemHl(z80); break;
-	case 0xEA: jpCond(z80, getFlag(z80, FLAG_PV)); break;
-	case 0xF2: jpCond(z80, getFlag(z80, FLAG_S) == 0); break;
-	case 0xFA: jpCond(z80, getFlag(z80, FLAG_S)); break;
-
-		//Restarts
-	case 0xC7: rst(z80, 0x00); break;
-	case 0xCF: rst(z80, 0x08); break;
-	case 0xD7: rst(z80, 0x10); break;
-	case 0xDF: rst(z80, 0x18); break;
-	case 0xE7: rst(z80, 0x20); break;
-	case 0xEF: rst(z80, 0x28); break;
-	case 0xF7: rst(z80, 0x30); break;
-	case 0xFF: rst(z80, 0x38); break;
-
-	case 0xD3: outa(z80); break;
-	case 0xDB: ina(z80); break;
-
-	case 0xC5: push(z80, &z80->bc); break;
-	case 0xD5: push(z80, &z80->de); break;
-	case 0xE5: push(z80, &z80->hl); break;
-	case 0xF5: push(z80, &z80->af); break;
-
-	case 0xC1: pop(z80, &z80->bc); break;
-	case 0xD1: pop(z80, &z80->de); break;
-	case 0xE1: pop(z80, &z80->hl); break;
-	case 0xF1: pop(z80, &z80->af); break;
-
-	case 0xF3: di(z80); break;
-	case 0xFB: ei(z80); break;
-
-	default:
-		printf("\n--Unimplemented Main Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
-	}
+	u32 iterations = (z80->block_budget + 20) / 21;
+	if (iterations == 0)
+		iterations = 1;
+	if (iterations > MAX_BLOCK_ITERATIONS)
+		iterations = MAX_BLOCK_ITERATIONS;
+
+	return (count < iterations) ? count : iterations;
 }
 
-void executeBitInstruction(struct Z80* z80, u8 opcode)
+//Recognizes loops that only poll a port or memory location into a, optionally
+//test it and branch back, e.g. in a,(0x7E) / cp 0xB0 / jr nz,loop. Nothing these
+//read can change until the next scheduled event or interrupt
+u8 z80IsIdleLoop(struct Z80* z80, u16 loop_start, u16 branch_pc)
 {
+	u16 pc = loop_start;
+	u8 opcode = z80ReadU8(z80, pc);
+	if (opcode == 0xDB) {
+		//vdp data port reads auto increment the vram address
+		u8 port = z80ReadU8(z80, pc + 1);
+		if (port >= 0x80 && port <= 0xBF && (port & 0x1) == 0)
+			return 0;
+		pc += 2;
+	}
+	else if (opcode == 0x3A) //ld a, (nn)
+		pc += 3;
+	else
+		return 0;
+
+	//optional test of a
+	opcode = z80ReadU8(z80, pc);
 	switch (opcode) {
-		
-	case 0x00: rlc(z80, &z80->bc.hi); break;
-	case 0x01: rlc(z80, &z80->bc.lo); break;
-	case 0x02: rlc(z80, &z80->de.hi); break;
-	case 0x03: rlc(z80, &z80->de.lo); break;
-	case 0x04: rlc(z80, &z80->hl.hi); break;
-	case 0x05: rlc(z80, &z80->hl.lo); break;
-	case 0x06: rlcMemHl(z80); break;
-	case 0x07: rlc(z80, &z80->af.hi); break;
-
-	
-	case 0x08: rrc(z80, &z80->bc.hi); break;
-	case 0x09: rrc(z80, &z80->bc.lo); break;
-	case 0x0A: rrc(z80, &z80->de.hi); break;
-	case 0x0B: rrc(z80, &z80->de.lo); break;
-	case 0x0C: rrc(z80, &z80->hl.hi); break;
-	case 0x0D: rrc(z80, &z80->hl.lo); break;
-	case 0x0E: rrcMemHl(z80); break;
-	case 0x0F: rrc(z80, &z80->af.hi); break;
-
-	case 0x10: rl(z80, &z80->bc.hi); break;
-	case 0x11: rl(z80, &z80->bc.lo); break;
-	case 0x12: rl(z80, &z80->de.hi); break;
-	case 0x13: rl(z80, &z80->de.lo); break;
-	case 0x14: rl(z80, &z80->hl.hi); break;
-	case 0x15: rl(z80, &z80->hl.lo); break;
-	case 0x16: rlMemHl(z80); break;
-	case 0x17: rl(z80, &z80->af.hi); break;
-
-	case 0x18: rr(z80, &z80->bc.hi); break;
-	case 0x19: rr(z80, &z80->bc.lo); break;
-	case 0x1A: rr(z80, &z80->de.hi); break;
-	case 0x1B: rr(z80, &z80->de.lo); break;
-	case 0x1C: rr(z80, &z80->hl.hi); break;
-	case 0x1D: rr(z80, &z80->hl.lo); break;
-	case 0x1E: rrMemHl(z80); break;
-	case 0x1F: rr(z80, &z80->af.hi); break;
-
-	case 0x20: sla(z80, &z80->bc.hi); break;
-	case 0x21: sla(z80, &z80->bc.lo); break;
-	case 0x22: sla(z80, &z80->de.hi); break;
-	case 0x23: sla(z80, &z80->de.lo); break;
-	case 0x24: sla(z80, &z80->hl.hi); break;
-	case 0x25: sla(z80, &z80->hl.lo); break;
-	case 0x26: slaMemHl(z80); break;
-	case 0x27: sla(z80, &z80->af.hi); break;
-
-	case 0x28: sra(z80, &z80->bc.hi); break;
-	case 0x29: sra(z80, &z80->bc.lo); break;
-	case 0x2A: sra(z80, &z80->de.hi); break;
-	case 0x2B: sra(z80, &z80->de.lo); break;
-	case 0x2C: sra(z80, &z80->hl.hi); break;
-	case 0x2D: sra(z80, &z80->hl.lo); break;
-	case 0x2E: sraMemHl(z80); break;
-	case 0x2F: sra(z80, &z80->af.hi); break;
-
-	case 0x30: sll(z80, &z80->bc.hi); break;
-	case 0x31: sll(z80, &z80->bc.lo); break;
-	case 0x32: sll(z80, &z80->de.hi); break;
-	case 0x33: sll(z80, &z80->de.lo); break;
-	case 0x34: sll(z80, &z80->hl.hi); break;
-	case 0x35: sll(z80, &z80->hl.lo); break;
-	case 0x36: sllMemHl(z80); break;
-	case 0x37: sll(z80, &z80->af.hi); break;
-
-		//srl
-	case 0x38: srl(z80, &z80->bc.hi); break;
-	case 0x39: srl(z80, &z80->bc.lo); break;
-	case 0x3A: srl(z80, &z80->de.hi); break;
-	case 0x3B: srl(z80, &z80->de.lo); break;
-	case 0x3C: srl(z80, &z80->hl.hi); break;
-	case 0x3D: srl(z80, &z80->hl.lo); break;
-	case 0x3E: srlMemHl(z80); break;
-	case 0x3F: srl(z80, &z80->af.hi); break;
-
-		//Bit
-	case 0x40: bit(z80, z80->bc.hi, 0); break;
-	case 0x41: bit(z80, z80->bc.lo, 0); break;
-	case 0x42: bit(z80, z80->de.hi, 0); break;
-	case 0x43: bit(z80, z80->de.lo, 0); break;
-	case 0x44: bit(z80, z80->hl.hi, 0); break;
-	case 0x45: bit(z80, z80->hl.lo, 0); break;
-	case 0x46: bitMemHl(z80, 0); break;
-	case 0x47: bit(z80, z80->af.hi, 0); break;
-
-	case 0x48: bit(z80, z80->bc.hi, 1); break;
-	case 0x49: bit(z80, z80->bc.lo, 1); break;
-	case 0x4A: bit(z80, z80->de.hi, 1); break;
-	case 0x4B: bit(z80, z80->de.lo, 1); break;
-	case 0x4C: bit(z80, z80->hl.hi, 1); break;
-	case 0x4D: bit(z80, z80->hl.lo, 1); break;
-	case 0x4E: bitMemHl(z80, 1); break;
-	case 0x4F: bit(z80, z80->af.hi, 1); break;
-
-	case 0x50: bit(z80, z80->bc.hi, 2); break;
-	case 0x51: bit(z80, z80->bc.lo, 2); break;
-	case 0x52: bit(z80, z80->de.hi, 2); break;
-	case 0x53: bit(z80, z80->de.lo, 2); break;
-	case 0x54: bit(z80, z80->hl.hi, 2); break;
-	case 0x55: bit(z80, z80->hl.lo, 2); break;
-	case 0x56: bitMemHl(z80, 2); break;
-	case 0x57: bit(z80, z80->af.hi, 2); break;
-
-	case 0x58: bit(z80, z80->bc.hi, 3); break;
-	case 0x59: bit(z80, z80->bc.lo, 3); break;
-	case 0x5A: bit(z80, z80->de.hi, 3); break;
-	case 0x5B: bit(z80, z80->de.lo, 3); break;
-	case 0x5C: bit(z80, z80->hl.hi, 3); break;
-	case 0x5D: bit(z80, z80->hl.lo, 3); break;
-	case 0x5E: bitMemHl(z80, 3); break;
-	case 0x5F: bit(z80, z80->af.hi, 3); break;
-
-	case 0x60: bit(z80, z80->bc.hi, 4); break;
-	case 0x61: bit(z80, z80->bc.lo, 4); break;
-	case 0x62: bit(z80, z80->de.hi, 4); break;
-	case 0x63: bit(z80, z80->de.lo, 4); break;
-	case 0x64: bit(z80, z80->hl.hi, 4); break;
-	case 0x65: bit(z80, z80->hl.lo, 4); break;
-	case 0x66: bitMemHl(z80, 4); break;
-	case 0x67: bit(z80, z80->af.hi, 4); break;
-
-	case 0x68: bit(z80, z80->bc.hi, 5); break;
-	case 0x69: bit(z80, z80->bc.lo, 5); break;
-	case 0x6A: bit(z80, z80->de.hi, 5); break;
-	case 0x6B: bit(z80, z80->de.lo, 5); break;
-	case 0x6C: bit(z80, z80->hl.hi, 5); break;
-	case 0x6D: bit(z80, z80->hl.lo, 5); break;
-	case 0x6E: bitMemHl(z80, 5); break;
-	case 0x6F: bit(z80, z80->af.hi, 5); break;
-
-	case 0x70: bit(z80, z80->bc.hi, 6); break;
-	case 0x71: bit(z80, z80->bc.lo, 6); break;
-	case 0x72: bit(z80, z80->de.hi, 6); break;
-	case 0x73: bit(z80, z80->de.lo, 6); break;
-	case 0x74: bit(z80, z80->hl.hi, 6); break;
-	case 0x75: bit(z80, z80->hl.lo, 6); break;
-	case 0x76: bitMemHl(z80, 6); break;
-	case 0x77: bit(z80, z80->af.hi, 6); break;
-
-	case 0x78: bit(z80, z80->bc.hi, 7); break;
-	case 0x79: bit(z80, z80->bc.lo, 7); break;
-	case 0x7A: bit(z80, z80->de.hi, 7); break;
-	case 0x7B: bit(z80, z80->de.lo, 7); break;
-	case 0x7C: bit(z80, z80->hl.hi, 7); break;
-	case 0x7D: bit(z80, z80->hl.lo, 7); break;
-	case 0x7E: bitMemHl(z80, 7); break;
-	case 0x7F: bit(z80, z80->af.hi, 7); break;
-
-	case 0x80: res(z80, &z80->bc.hi, 0); break;
-	case 0x81: res(z80, &z80->bc.lo, 0); break;
-	case 0x82: res(z80, &z80->de.hi, 0); break;
-	case 0x83: res(z80, &z80->de.lo, 0); break;
-	case 0x84: res(z80, &z80->hl.hi, 0); break;
-	case 0x85: res(z80, &z80->hl.lo, 0); break;
-	case 0x86: resMemHl(z80, 0); break;
-	case 0x87: res(z80, &z80->af.hi, 0); break;
-
-	case 0x88: res(z80, &z80->bc.hi, 1); break;
-	case 0x89: res(z80, &z80->bc.lo, 1); break;
-	case 0x8A: res(z80, &z80->de.hi, 1); break;
-	case 0x8B: res(z80, &z80->de.lo, 1); break;
-	case 0x8C: res(z80, &z80->hl.hi, 1); break;
-	case 0x8D: res(z80, &z80->hl.lo, 1); break;
-	case 0x8E: resMemHl(z80, 1); break;
-	case 0x8F: res(z80, &z80->af.hi, 1); break;
-
-	case 0x90: res(z80, &z80->bc.hi, 2); break;
-	case 0x91: res(z80, &z80->bc.lo, 2); break;
-	case 0x92: res(z80, &z80->de.hi, 2); break;
-	case 0x93: res(z80, &z80->de.lo, 2); break;
-	case 0x94: res(z80, &z80->hl.hi, 2); break;
-	case 0x95: res(z80, &z80->hl.lo, 2); break;
-	case 0x96: resMemHl(z80, 2); break;
-	case 0x97: res(z80, &z80->af.hi, 2); break;
-
-	case 0x98: res(z80, &z80->bc.hi, 3); break;
-	case 0x99: res(z80, &z80->bc.lo, 3); break;
-	case 0x9A: res(z80, &z80->de.hi, 3); break;
-	case 0x9B: res(z80, &z80->de.lo, 3); break;
-	case 0x9C: res(z80, &z80->hl.hi, 3); break;
-	case 0x9D: res(z80, &z80->hl.lo, 3); break;
-	case 0x9E: resMemHl(z80, 3); break;
-	case 0x9F: res(z80, &z80->af.hi, 3); break;
-
-	case 0xA0: res(z80, &z80->bc.hi, 4); break;
-	case 0xA1: res(z80, &z80->bc.lo, 4); break;
-	case 0xA2: res(z80, &z80->de.hi, 4); break;
-	case 0xA3: res(z80, &z80->de.lo, 4); break;
-	case 0xA4: res(z80, &z80->hl.hi, 4); break;
-	case 0xA5: res(z80, &z80->hl.lo, 4); break;
-	case 0xA6: resMemHl(z80, 4); break;
-	case 0xA7: res(z80, &z80->af.hi, 4); break;
-
-	case 0xA8: res(z80, &z80->bc.hi, 5); break;
-	case 0xA9: res(z80, &z80->bc.lo, 5); break;
-	case 0xAA: res(z80, &z80->de.hi, 5); break;
-	case 0xAB: res(z80, &z80->de.lo, 5); break;
-	case 0xAC: res(z80, &z80->hl.hi, 5); break;
-	case 0xAD: res(z80, &z80->hl.lo, 5); break;
-	case 0xAE: resMemHl(z80, 5); break;
-	case 0xAF: res(z80, &z80->af.hi, 5); break;
-
-	case 0xB0: res(z80, &z80->bc.hi, 6); break;
-	case 0xB1: res(z80, &z80->bc.lo, 6); break;
-	case 0xB2: res(z80, &z80->de.hi, 6); break;
-	case 0xB3: res(z80, &z80->de.lo, 6); break;
-	case 0xB4: res(z80, &z80->hl.hi, 6); break;
-	case 0xB5: res(z80, &z80->hl.lo, 6); break;
-	case 0xB6: resMemHl(z80, 6); break;
-	case 0xB7: res(z80, &z80->af.hi, 6); break;
-
-	case 0xB8: res(z80, &z80->bc.hi, 7); break;
-	case 0xB9: res(z80, &z80->bc.lo, 7); break;
-	case 0xBA: res(z80, &z80->de.hi, 7); break;
-	case 0xBB: res(z80, &z80->de.lo, 7); break;
-	case 0xBC: res(z80, &z80->hl.hi, 7); break;
-	case 0xBD: res(z80, &z80->hl.lo, 7); break;
-	case 0xBE: resMemHl(z80, 7); break;
-	case 0xBF: res(z80, &z80->af.hi, 7); break;
-
-	case 0xC0: set(z80, &z80->bc.hi, 0); break;
-	case 0xC1: set(z80, &z80->bc.lo, 0); break;
-	case 0xC2: set(z80, &z80->de.hi, 0); break;
-	case 0xC3: set(z80, &z80->de.lo, 0); break;
-	case 0xC4: set(z80, &z80->hl.hi, 0); break;
-	case 0xC5: set(z80, &z80->hl.lo, 0); break;
-	case 0xC6: setMemHl(z80, 0); break;
-	case 0xC7: set(z80, &z80->af.hi, 0); break;
-
-	case 0xC8: set(z80, &z80->bc.hi, 1); break;
-	case 0xC9: set(z80, &z80->bc.lo, 1); break;
-	case 0xCA: set(z80, &z80->de.hi, 1); break;
-	case 0xCB: set(z80, &z80->de.lo, 1); break;
-	case 0xCC: set(z80, &z80->hl.hi, 1); break;
-	case 0xCD: set(z80, &z80->hl.lo, 1); break;
-	case 0xCE: setMemHl(z80, 1); break;
-	case 0xCF: set(z80, &z80->af.hi, 1); break;
-
-	case 0xD0: set(z80, &z80->bc.hi, 2); break;
-	case 0xD1: set(z80, &z80->bc.lo, 2); break;
-	case 0xD2: set(z80, &z80->de.hi, 2); break;
-	case 0xD3: set(z80, &z80->de.lo, 2); break;
-	case 0xD4: set(z80, &z80->hl.hi, 2); break;
-	case 0xD5: set(z80, &z80->hl.lo, 2); break;
-	case 0xD6: setMemHl(z80, 2); break;
-	case 0xD7: set(z80, &z80->af.hi, 2); break;
-
-	case 0xD8: set(z80, &z80->bc.hi, 3); break;
-	case 0xD9: set(z80, &z80->bc.lo, 3); break;
-	case 0xDA: set(z80, &z80->de.hi, 3); break;
-	case 0xDB: set(z80, &z80->de.lo, 3); break;
-	case 0xDC: set(z80, &z80->hl.hi, 3); break;
-	case 0xDD: set(z80, &z80->hl.lo, 3); break;
-	case 0xDE: setMemHl(z80, 3); break;
-	case 0xDF: set(z80, &z80->af.hi, 3); break;
-
-	case 0xE0: set(z80, &z80->bc.hi, 4); break;
-	case 0xE1: set(z80, &z80->bc.lo, 4); break;
-	case 0xE2: set(z80, &z80->de.hi, 4); break;
-	case 0xE3: set(z80, &z80->de.lo, 4); break;
-	case 0xE4: set(z80, &z80->hl.hi, 4); break;
-	case 0xE5: set(z80, &z80->hl.lo, 4); break;
-	case 0xE6: setMemHl(z80, 4); break;
-	case 0xE7: set(z80, &z80->af.hi, 4); break;
-
-	case 0xE8: set(z80, &z80->bc.hi, 5); break;
-	case 0xE9: set(z80, &z80->bc.lo, 5); break;
-	case 0xEA: set(z80, &z80->de.hi, 5); break;
-	case 0xEB: set(z80, &z80->de.lo, 5); break;
-	case 0xEC: set(z80, &z80->hl.hi, 5); break;
-	case 0xED: set(z80, &z80->hl.lo, 5); break;
-	case 0xEE: setMemHl(z80, 5); break;
-	case 0xEF: set(z80, &z80->af.hi, 5); break;
-
-	case 0xF0: set(z80, &z80->bc.hi, 6); break;
-	case 0xF1: set(z80, &z80->bc.lo, 6); break;
-	case 0xF2: set(z80, &z80->de.hi, 6); break;
-	case 0xF3: set(z80, &z80->de.lo, 6); break;
-	case 0xF4: set(z80, &z80->hl.hi, 6); break;
-	case 0xF5: set(z80, &z80->hl.lo, 6); break;
-	case 0xF6: setMemHl(z80, 6); break;
-	case 0xF7: set(z80, &z80->af.hi, 6); break;
-
-	case 0xF8: set(z80, &z80->bc.hi, 7); break;
-	case 0xF9: set(z80, &z80->bc.lo, 7); break;
-	case 0xFA: set(z80, &z80->de.hi, 7); break;
-	case 0xFB: set(z80, &z80->de.lo, 7); break;
-	case 0xFC: set(z80, &z80->hl.hi, 7); break;
-	case 0xFD: set(z80, &z80->hl.lo, 7); break;
-	case 0xFE: setMemHl(z80, 7); break;
-	case 0xFF: set(z80, &z80->af.hi, 7); break;
-
-	default:
-		printf("\n--Unimplemented Bit Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
+		case 0xFE: case 0xE6: case 0xF6: case 0xEE: pc += 2; break; //cp/and/or/xor n
+		case 0xB7: case 0xA7: case 0x07: case 0x0F: pc += 1; break; //or a, and a, rlca, rrca
+		case 0xCB: {
+			//bit b, a
+			u8 bit_opcode = z80ReadU8(z80, pc + 1);
+			if ((bit_opcode & 0xC7) != 0x47)
+				return 0;
+			pc += 2;
+		}
 		break;
 	}
-}
+	if (pc != branch_pc)
+		return 0;
 
-void executeIxInstruction(struct Z80* z80, u8 opcode)
-{
+	opcode = z80ReadU8(z80, branch_pc);
 	switch (opcode) {
-		//Loads
-	case 0x22: loadMemReg16(z80, &z80->ix); z80->cycles += 4; break;
-	case 0x2A: load16Reg(z80, &z80->ix); z80->cycles += 4; break;
-
-	case 0x26: loadReg8(z80, &z80->ix.hi); z80->cycles += 4; break;
-	case 0x2E: loadReg8(z80, &z80->ix.lo); z80->cycles += 4; break;
-
-	case 0x40: case 0x41: case 0x42:
-	case 0x43: case 0x47: case 0x48:
-	case 0x49: case 0x4A: case 0x4B:
-	case 0x4F: case 0x50: case 0x51:
-	case 0x52: case 0x53: case 0x57:
-	case 0x58: case 0x59: case 0x5A:
-	case 0x5B: case 0x5F: case 0x78:
-	case 0x79: case 0x7A: case 0x7B:
-	case 0x7F:
-		executeMainInstruction(z80, opcode); z80->cycles += 4; break;
-
-	case 0x44: loadReg(z80, &z80->bc.hi, z80->ix.hi); z80->cycles += 4; break;
-	case 0x45: loadReg(z80, &z80->bc.hi, z80->ix.lo); z80->cycles += 4; break;
-	case 0x4C: loadReg(z80, &z80->bc.lo, z80->ix.hi); z80->cycles += 4; break;
-	case 0x4D: loadReg(z80, &z80->bc.lo, z80->ix.lo); z80->cycles += 4; break;
-	case 0x54: loadReg(z80, &z80->de.hi, z80->ix.hi); z80->cycles += 4; break;
-	case 0x55: loadReg(z80, &z80->de.hi, z80->ix.lo); z80->cycles += 4; break;
-	case 0x5C: loadReg(z80, &z80->de.lo, z80->ix.hi); z80->cycles += 4; break;
-	case 0x5D: loadReg(z80, &z80->de.lo, z80->ix.lo); z80->cycles += 4; break;
-
-	case 0x60: loadReg(z80, &z80->ix.hi, z80->bc.hi); z80->cycles += 4; break;
-	case 0x61: loadReg(z80, &z80->ix.hi, z80->bc.lo); z80->cycles += 4; break;
-	case 0x62: loadReg(z80, &z80->ix.hi, z80->de.hi); z80->cycles += 4; break;
-	case 0x63: loadReg(z80, &z80->ix.hi, z80->de.lo); z80->cycles += 4; break;
-	case 0x64: loadReg(z80, &z80->ix.hi, z80->ix.hi); z80->cycles += 4; break;
-	case 0x65: loadReg(z80, &z80->ix.hi, z80->ix.lo); z80->cycles += 4; break;
-	case 0x67: loadReg(z80, &z80->ix.hi, z80->af.hi); z80->cycles += 4; break;
-	case 0x68: loadReg(z80, &z80->ix.lo, z80->bc.hi); z80->cycles += 4; break;
-	case 0x69: loadReg(z80, &z80->ix.lo, z80->bc.lo); z80->cycles += 4; break;
-	case 0x6A: loadReg(z80, &z80->ix.lo, z80->de.hi); z80->cycles += 4; break;
-	case 0x6B: loadReg(z80, &z80->ix.lo, z80->de.lo); z80->cycles += 4; break;
-	case 0x6C: loadReg(z80, &z80->ix.lo, z80->ix.hi); z80->cycles += 4; break;
-	case 0x6D: loadReg(z80, &z80->ix.lo, z80->ix.lo); z80->cycles += 4; break;
-	case 0x6F: loadReg(z80, &z80->ix.lo, z80->af.hi); z80->cycles += 4; break;
-	case 0x7C: loadReg(z80, &z80->af.hi, z80->ix.hi); z80->cycles += 4; break;
-	case 0x7D: loadReg(z80, &z80->af.hi, z80->ix.lo); z80->cycles += 4; break;
-
-		//Load value from ix + offset into reg8
-	case 0x46: loadRegIx(z80, &z80->bc.hi); break;
-	case 0x4E: loadRegIx(z80, &z80->bc.lo); break;
-	case 0x56: loadRegIx(z80, &z80->de.hi); break;
-	case 0x5E: loadRegIx(z80, &z80->de.lo); break;
-	case 0x66: loadRegIx(z80, &z80->hl.hi); break;
-	case 0x6E: loadRegIx(z80, &z80->hl.lo); break;
-	case 0x7E: loadRegIx(z80, &z80->af.hi); break;
-
-		//Load reg8 into memory location ix + immediate s8
-	case 0x36: loadIxImm(z80); break;
-	case 0x70: loadIxReg(z80, z80->bc.hi); break;
-	case 0x71: loadIxReg(z80, z80->bc.lo); break;
-	case 0x72: loadIxReg(z80, z80->de.hi); break;
-	case 0x73: loadIxReg(z80, z80->de.lo); break;
-	case 0x74: loadIxReg(z80, z80->hl.hi); break;
-	case 0x75: loadIxReg(z80, z80->hl.lo); break;
-	case 0x77: loadIxReg(z80, z80->af.hi); break;
-
-	case 0xF9: loadSpReg(z80, &z80->ix); break;
-
-		//Arithmetic
-	case 0x09: addReg16(z80, &z80->ix, &z80->bc); break;
-	case 0x19: addReg16(z80, &z80->ix, &z80->de); break;
-	case 0x29: addReg16(z80, &z80->ix, &z80->ix); break;
-	case 0x39: addReg16(z80, &z80->ix, &z80->sp); break;
-
-
-	case 0x23: incReg16(z80, &z80->ix); z80->cycles += 4; break;
-	case 0x24: incReg8(z80, &z80->ix.hi); z80->cycles += 4; break;
-	case 0x2C: incReg8(z80, &z80->ix.lo); z80->cycles += 4; break;
-
-	case 0x25: decReg8(z80, &z80->ix.hi); z80->cycles += 4; break;
-	case 0x2D: decReg8(z80, &z80->ix.lo); z80->cycles += 4; break;
-
-	case 0x2B: decReg16(z80, &z80->ix); z80->cycles += 4; break;
-
-	case 0x34: incMemIx(z80); break;
-	case 0x35: decMemIx(z80); break;
-
-
-	case 0x84: addReg8(z80, &z80->af.hi, z80->ix.hi); break;
-	case 0x85: addReg8(z80, &z80->af.hi, z80->ix.lo); break;
-	case 0x86: addMemIx(z80, &z80->af.hi); break;
-
-	case 0x8C: adcReg8(z80, &z80->af.hi, z80->ix.hi); break;
-	case 0x8D: adcReg8(z80, &z80->af.hi, z80->ix.lo); break;
-	case 0x8E: adcMemIx(z80, &z80->af.hi); break;
-
-	case 0x94: subReg8(z80, &z80->af.hi, z80->ix.hi); break;
-	case 0x95: subReg8(z80, &z80->af.hi, z80->ix.lo); break;
-	case 0x96: subMemIx(z80, &z80->af.hi); break;
-
-	case 0x9C: sbcReg8(z80, &z80->af.hi, z80->ix.hi); break;
-	case 0x9D: sbcReg8(z80, &z80->af.hi, z80->ix.lo); break;
-	case 0x9E: sbcMemIx(z80, &z80->af.hi); break;
-
-		//Logical
-	case 0xA4: and (z80, z80->ix.hi); break;
-	case 0xA5: and (z80, z80->ix.lo); break;
-	case 0xA6: andMemIx(z80); break;
-
-	case 0xAC: xor (z80, z80->ix.hi); break;
-	case 0xAD: xor (z80, z80->ix.lo); break;
-	case 0xAE: xorMemIx(z80); break;
-
-	case 0xB4: or (z80, z80->ix.hi); break;
-	case 0xB5: or (z80, z80->ix.lo); break;
-	case 0xB6: orMemIx(z80); break;
-
-	case 0xBC: cp(z80, z80->ix.hi); break;
-	case 0xBD: cp(z80, z80->ix.lo); break;
-	case 0xBE: cpMemIx(z80); break;
-
-	case 0x21: loadReg16(z80, &z80->ix); z80->cycles += 4; break;
-
-	case 0xE9: jpMemIx(z80); break;
-
-	case 0xE3: ex(z80, &z80->sp, &z80->ix); break;
-
-	case 0xE1: pop(z80, &z80->ix); break;
-	case 0xE5: push(z80, &z80->ix); break;
-	default:
-		printf("\n--Unimplemented Ix Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
+		case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: return 1; //jr, jr cc
+		case 0xC3: case 0xC2: case 0xCA: case 0xD2: case 0xDA: return 1; //jp, jp cc
 	}
+	return 0;
 }
 
-void executeIxBitInstruction(struct Z80* z80, u8 opcode)
+u32 z80SkipIdleLoop(struct Z80* z80, u16 branch_pc, u32 cycles, s32 cycle_budget)
 {
-	switch (opcode) {
-		case 0x06: rlcMemIx(z80); break;
-		case 0x0E: rrcMemIx(z80); break;
-		case 0x16: rlMemIx(z80); break;
-		case 0x1E: rrMemIx(z80); break;
-		case 0x26: slaMemIx(z80); break;
-		case 0x2E: sraMemIx(z80); break;
-		case 0x3E: srlMemIx(z80); break;
-		case 0x36: sllMemIx(z80); break;
-
-		case 0x46: bitMemIx(z80, 0); break;
-		case 0x4E: bitMemIx(z80, 1); break;
-		case 0x56: bitMemIx(z80, 2); break;
-		case 0x5E: bitMemIx(z80, 3); break;
-		case 0x66: bitMemIx(z80, 4); break;
-		case 0x6E: bitMemIx(z80, 5); break;
-		case 0x76: bitMemIx(z80, 6); break;
-		case 0x7E: bitMemIx(z80, 7); break;
-
-		case 0x86: resMemIx(z80, 0); break;
-		case 0x8E: resMemIx(z80, 1); break;
-		case 0x96: resMemIx(z80, 2); break;
-		case 0x9E: resMemIx(z80, 3); break;
-		case 0xA6: resMemIx(z80, 4); break;
-		case 0xAE: resMemIx(z80, 5); break;
-		case 0xB6: resMemIx(z80, 6); break;
-		case 0xBE: resMemIx(z80, 7); break;
-
-		case 0xC6: setMemIx(z80, 0); break;
-		case 0xCE: setMemIx(z80, 1); break;
-		case 0xD6: setMemIx(z80, 2); break;
-		case 0xDE: setMemIx(z80, 3); break;
-		case 0xE6: setMemIx(z80, 4); break;
-		case 0xEE: setMemIx(z80, 5); break;
-		case 0xF6: setMemIx(z80, 6); break;
-		case 0xFE: setMemIx(z80, 7); break;
-
-	default:
-		printf("\n--Unimplemented Ix Bit Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
+	u16 loop_start = z80->pc;
+	if (!z80IsIdleLoop(z80, loop_start, branch_pc)) {
+		z80->idle_loop_armed = 0;
+		return 0;
 	}
+
+	//the first pass can still change a (e.g. status flags cleared by the read),
+	//only skip once a full pass left a and the flags exactly as they were
+	z80ResolveFlags(z80);
+	if (!z80->idle_loop_armed || z80->idle_loop_pc != loop_start || z80->idle_loop_af != z80->af.value) {
+		z80->idle_loop_armed = 1;
+		z80->idle_loop_pc = loop_start;
+		z80->idle_loop_af = z80->af.value;
+		z80->idle_loop_cycles = cycles;
+		return 0;
+	}
+
+	//skip whole passes, leaving the last one that reaches the budget to run normally
+	u32 loop_cycles = cycles - z80->idle_loop_cycles;
+	if ((s32)cycles >= cycle_budget || loop_cycles == 0)
+		return 0;
+
+	u32 passes = (cycle_budget - cycles - 1) / loop_cycles;
+	u32 skipped = passes * loop_cycles;
+
+	z80->idle_loop_cycles = cycles + skipped;
+	z80->idle_skipped_cycles += skipped;
+	return skipped;
 }
 
-void executeExtendedInstruction(struct Z80* z80, u8 opcode)
+/*
+	Instruction dispatch
+
+	Every prefix group gets its own 256 entry table built from the opcode lists in
+	Z80Opcodes.h, so decoding an instruction is one indexed jump per opcode byte.
+	Compilers that support labels as values (gcc/clang) jump straight to the handler
+	code with computed gotos, everything else goes through plain function pointers.
+*/
+
+//Displaced bit instructions (DD CB d op / FD CB d op) leave pc on the opcode byte
+//after the handler has fetched the displacement, so skip over it once they are done
+#define Z80_EPILOGUE_Main
+#define Z80_EPILOGUE_Bit
+#define Z80_EPILOGUE_Ix
+#define Z80_EPILOGUE_IxBit z80->pc += 1
+#define Z80_EPILOGUE_Extended
+#define Z80_EPILOGUE_Iy
+#define Z80_EPILOGUE_IyBit z80->pc += 1
+
+#define Z80_FOR_EACH_GROUP(GROUP) \
+	GROUP(Main, "Main", Z80_MAIN_OPCODES) \
+	GROUP(Bit, "Bit", Z80_BIT_OPCODES) \
+	GROUP(Ix, "Ix", Z80_IX_OPCODES) \
+	GROUP(IxBit, "Ix Bit", Z80_IX_BIT_OPCODES) \
+	GROUP(Extended, "Extended", Z80_EXTENDED_OPCODES) \
+	GROUP(Iy, "Iy", Z80_IY_OPCODES) \
+	GROUP(IyBit, "Iy Bit", Z80_IY_BIT_OPCODES)
+
+static void z80UnimplementedInstruction(struct Z80* z80, const char* group, u8 opcode)
 {
-	switch (opcode) {
-		//Loads
-	case 0x43: loadMemReg16(z80, &z80->bc); break;
-	case 0x53: loadMemReg16(z80, &z80->de); break;
-	case 0x73: loadMemReg16(z80, &z80->sp); break;
-	case 0x57: loadAWithI(z80); break;
-	case 0x5F: loadAWithR(z80); break;
-	case 0x7B: load16Reg(z80, &z80->sp); z80->cycles += 4; break;
-	case 0x4B: load16Reg(z80, &z80->bc); z80->cycles += 4; break;
-	case 0x5B: load16Reg(z80, &z80->de); z80->cycles += 4; break;
-
-	case 0x40: in(z80, z80->bc.lo, &z80->bc.hi, opcode); break;
-	case 0x48: in(z80, z80->bc.lo, &z80->bc.lo, opcode); break;
-	case 0x50: in(z80, z80->bc.lo, &z80->de.hi, opcode); break;
-	case 0x58: in(z80, z80->bc.lo, &z80->de.lo, opcode); break;
-	case 0x60: in(z80, z80->bc.lo, &z80->hl.hi, opcode); break;
-	case 0x68: in(z80, z80->bc.lo, &z80->hl.lo, opcode); break;
-	case 0x70: in(z80, z80->bc.lo, NULL, opcode); break;
-	case 0x78: in(z80, z80->bc.lo, &z80->af.hi, opcode); break;
-
-	case 0x41: out(z80, z80->bc.lo, z80->bc.hi); break;
-	case 0x49: out(z80, z80->bc.lo, z80->bc.lo); break;
-	case 0x51: out(z80, z80->bc.lo, z80->de.hi); break;
-	case 0x59: out(z80, z80->bc.lo, z80->de.lo); break;
-	case 0x61: out(z80, z80->bc.lo, z80->hl.hi); break;
-	case 0x69: out(z80, z80->bc.lo, z80->hl.lo); break;
-	case 0x71: out(z80, z80->bc.lo, 0); break;
-	case 0x79: out(z80, z80->bc.lo, z80->af.hi); break;
-
-	case 0x56: im(z80, One); break;
-	case 0x76: im(z80, One); break;
-
-	case 0xA1: cpi(z80); break;
-	case 0xB1: cpir(z80); break;
-	case 0xA9: cpd(z80); break;
-	case 0xB9: cpdr(z80); break;
-	case 0xA8: ldd(z80); break;
-	case 0xB8: lddr(z80); break;
-	case 0x67: rrd(z80); break;
-	case 0x6F: rld(z80); break;
-
-		//Arithmetic
-	case 0x42: sbcReg16(z80, &z80->hl, &z80->bc); break;
-	case 0x52: sbcReg16(z80, &z80->hl, &z80->de); break;
-	case 0x62: sbcReg16(z80, &z80->hl, &z80->hl); break;
-	case 0x72: sbcReg16(z80, &z80->hl, &z80->sp); break;
-
-	case 0x4A: adcReg16(z80, &z80->hl, &z80->bc); break;
-	case 0x5A: adcReg16(z80, &z80->hl, &z80->de); break;
-	case 0x6A: adcReg16(z80, &z80->hl, &z80->hl); break;
-	case 0x7A: adcReg16(z80, &z80->hl, &z80->sp); break;
-
-		//Misc
-	case 0x44: neg(z80); break;
-
-		//Returns
-	case 0x45: retn(z80); break;
-	case 0x4D: reti(z80); break;
-	case 0x55: retn(z80); break;
-	case 0x5D: retn(z80); break;
-	case 0x65: retn(z80); break;
-	case 0x6D: retn(z80); break;
-	case 0x75: retn(z80); break;
-	case 0x7D: retn(z80); break;
-
-		//I/O instructions
-	case 0xA0: ldi(z80); break;
-	case 0xA2: ini(z80); break;
-	case 0xA3: outi(z80); break;
-	case 0xAB: outd(z80); break;
-	case 0xB0: ldir(z80); break;
-	case 0xB3: otir(z80); break;
-	case 0xBB: otdr(z80); break;
-
-	default:
-		printf("\n--Unimplemented Extended Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
-	}
+	printf("\n--Unimplemented %s Instruction--: 0x%02X\n", group, opcode);
+	printf("PC: 0x%04X\n", z80->pc);
+	assert(0);
+	z80->halted = 1;
 }
 
-void executeIyInstruction(struct Z80* z80, u8 opcode)
+#ifdef Z80_COMPUTED_GOTO
+
+#define Z80_DISPATCH(group, next) { opcode = (next); goto *z80##group##Labels[opcode]; }
+
+#define Z80_LABEL_ADDRESS(group, op, body) [op] = &&group##_##op,
+#define Z80_LABEL_BODY(group, op, body) group##_##op: body; Z80_EPILOGUE_##group; goto finished;
+
+#define Z80_DECLARE_LABELS(group, name, list) \
+	static void* const z80##group##Labels[0x100] = { \
+		[0 ... 0xFF] = &&group##_unimplemented, \
+		list(Z80_LABEL_ADDRESS, group) \
+	};
+
+#define Z80_DEFINE_LABELS(group, name, list) \
+	list(Z80_LABEL_BODY, group) \
+	group##_unimplemented: \
+		z80UnimplementedInstruction(z80, name, opcode); \
+		Z80_EPILOGUE_##group; \
+		goto finished;
+
+void executeInstruction(struct Z80* z80, u8 opcode)
 {
-	switch (opcode) {
-		//Loads
-	case 0x2A: load16Reg(z80, &z80->iy); z80->cycles += 4; break;
-	case 0x22: loadMemReg16(z80, &z80->iy); z80->cycles += 4; break;
-
-	case 0x26: loadReg8(z80, &z80->iy.hi); z80->cycles += 4; break;
-	case 0x2E: loadReg8(z80, &z80->iy.lo); z80->cycles += 4; break;
-
-	case 0x40: case 0x41: case 0x42:
-	case 0x43: case 0x47: case 0x48:
-	case 0x49: case 0x4A: case 0x4B:
-	case 0x4F: case 0x50: case 0x51:
-	case 0x52: case 0x53: case 0x57:
-	case 0x58: case 0x59: case 0x5A:
-	case 0x5B: case 0x5F: case 0x78:
-	case 0x79: case 0x7A: case 0x7B:
-	case 0x7F:
-		executeMainInstruction(z80, opcode); z80->cycles += 4; break;
-
-	case 0x44: loadReg(z80, &z80->bc.hi, z80->iy.hi); z80->cycles += 4; break;
-	case 0x45: loadReg(z80, &z80->bc.hi, z80->iy.lo); z80->cycles += 4; break;
-	case 0x4C: loadReg(z80, &z80->bc.lo, z80->iy.hi); z80->cycles += 4; break;
-	case 0x4D: loadReg(z80, &z80->bc.lo, z80->iy.lo); z80->cycles += 4; break;
-	case 0x54: loadReg(z80, &z80->de.hi, z80->iy.hi); z80->cycles += 4; break;
-	case 0x55: loadReg(z80, &z80->de.hi, z80->iy.lo); z80->cycles += 4; break;
-	case 0x5C: loadReg(z80, &z80->de.lo, z80->iy.hi); z80->cycles += 4; break;
-	case 0x5D: loadReg(z80, &z80->de.lo, z80->iy.lo); z80->cycles += 4; break;
-
-	case 0x60: loadReg(z80, &z80->iy.hi, z80->bc.hi); z80->cycles += 4; break;
-	case 0x61: loadReg(z80, &z80->iy.hi, z80->bc.lo); z80->cycles += 4; break;
-	case 0x62: loadReg(z80, &z80->iy.hi, z80->de.hi); z80->cycles += 4; break;
-	case 0x63: loadReg(z80, &z80->iy.hi, z80->de.lo); z80->cycles += 4; break;
-	case 0x64: loadReg(z80, &z80->iy.hi, z80->iy.hi); z80->cycles += 4; break;
-	case 0x65: loadReg(z80, &z80->iy.hi, z80->iy.lo); z80->cycles += 4; break;
-	case 0x67: loadReg(z80, &z80->iy.hi, z80->af.hi); z80->cycles += 4; break;
-	case 0x68: loadReg(z80, &z80->iy.lo, z80->bc.hi); z80->cycles += 4; break;
-	case 0x69: loadReg(z80, &z80->iy.lo, z80->bc.lo); z80->cycles += 4; break;
-	case 0x6A: loadReg(z80, &z80->iy.lo, z80->de.hi); z80->cycles += 4; break;
-	case 0x6B: loadReg(z80, &z80->iy.lo, z80->de.lo); z80->cycles += 4; break;
-	case 0x6C: loadReg(z80, &z80->iy.lo, z80->iy.hi); z80->cycles += 4; break;
-	case 0x6D: loadReg(z80, &z80->iy.lo, z80->iy.lo); z80->cycles += 4; break;
-	case 0x6F: loadReg(z80, &z80->iy.lo, z80->af.hi); z80->cycles += 4; break;
-	case 0x7C: loadReg(z80, &z80->af.hi, z80->iy.hi); z80->cycles += 4; break;
-	case 0x7D: loadReg(z80, &z80->af.hi, z80->iy.lo); z80->cycles += 4; break;
-
-		//Load value from ix + offset into reg8
-	case 0x46: loadRegIy(z80, &z80->bc.hi); break;
-	case 0x4E: loadRegIy(z80, &z80->bc.lo); break;
-	case 0x56: loadRegIy(z80, &z80->de.hi); break;
-	case 0x5E: loadRegIy(z80, &z80->de.lo); break;
-	case 0x66: loadRegIy(z80, &z80->hl.hi); break;
-	case 0x6E: loadRegIy(z80, &z80->hl.lo); break;
-	case 0x7E: loadRegIy(z80, &z80->af.hi); break;
-
-		//Load reg8 into memory location ix + immediate s8
-	case 0x36: loadIyImm(z80); break;
-	case 0x70: loadIyReg(z80, z80->bc.hi); break;
-	case 0x71: loadIyReg(z80, z80->bc.lo); break;
-	case 0x72: loadIyReg(z80, z80->de.hi); break;
-	case 0x73: loadIyReg(z80, z80->de.lo); break;
-	case 0x74: loadIyReg(z80, z80->hl.hi); break;
-	case 0x75: loadIyReg(z80, z80->hl.lo); break;
-	case 0x77: loadIyReg(z80, z80->af.hi); break;
-
-	case 0xF9: loadSpReg(z80, &z80->iy); break;
-
-		//Arithmetic
-	case 0x09: addReg16(z80, &z80->iy, &z80->bc); break;
-	case 0x19: addReg16(z80, &z80->iy, &z80->de); break;
-	case 0x29: addReg16(z80, &z80->iy, &z80->iy); break;
-	case 0x39: addReg16(z80, &z80->iy, &z80->sp); break;
-
-	case 0x21: loadReg16(z80, &z80->iy); z80->cycles += 4; break;
-	case 0x23: incReg16(z80, &z80->iy); z80->cycles += 4; break;
-	case 0x2B: decReg16(z80, &z80->iy); z80->cycles += 4; break;
-
-	case 0x24: incReg8(z80, &z80->iy.hi); z80->cycles += 4; break;
-	case 0x2C: incReg8(z80, &z80->iy.lo); z80->cycles += 4; break;
-
-	case 0x25: decReg8(z80, &z80->iy.hi); z80->cycles += 4; break;
-	case 0x2D: decReg8(z80, &z80->iy.lo); z80->cycles += 4; break;
-
-	case 0x34: incMemIy(z80); break;
-	case 0x35: decMemIy(z80); break;
-
-	case 0x84: addReg8(z80, &z80->af.hi, z80->iy.hi); break;
-	case 0x85: addReg8(z80, &z80->af.hi, z80->iy.lo); break;
-	case 0x86: addMemIy(z80, &z80->af.hi); break;
-
-	case 0x8C: adcReg8(z80, &z80->af.hi, z80->iy.hi); break;
-	case 0x8D: adcReg8(z80, &z80->af.hi, z80->iy.lo); break;
-	case 0x8E: adcMemIy(z80, &z80->af.hi); break;
-
-	case 0x94: subReg8(z80, &z80->af.hi, z80->iy.hi); break;
-	case 0x95: subReg8(z80, &z80->af.hi, z80->iy.lo); break;
-	case 0x96: subMemIy(z80, &z80->af.hi); break;
-
-	case 0x9C: sbcReg8(z80, &z80->af.hi, z80->iy.hi); break;
-	case 0x9D: sbcReg8(z80, &z80->af.hi, z80->iy.lo); break;
-	case 0x9E: sbcMemIy(z80, &z80->af.hi); break;
-
-		//Logical
-	case 0xA4: and (z80, z80->iy.hi); break;
-	case 0xA5: and (z80, z80->iy.lo); break;
-	case 0xA6: andMemIy(z80); break;
-
-	case 0xAC: xor (z80, z80->iy.hi); break;
-	case 0xAD: xor (z80, z80->iy.lo); break;
-	case 0xAE: xorMemIy(z80); break;
-
-	case 0xB4: or (z80, z80->iy.hi); break;
-	case 0xB5: or (z80, z80->iy.lo); break;
-	case 0xB6: orMemIy(z80); break;
-
-	case 0xBC: cp(z80, z80->iy.hi); break;
-	case 0xBD: cp(z80, z80->iy.lo); break;
-	case 0xBE: cpMemIy(z80); break;
-
-	case 0xE9: jpMemIy(z80); break;
-
-	case 0xE3: ex(z80, &z80->sp, &z80->iy); break;
-
-	case 0xE1: pop(z80, &z80->iy); break;
-	case 0xE5: push(z80, &z80->iy); break;
-	default:
-		printf("\n--Unimplemented Iy Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
+	//the range default is meant to be overridden by the opcodes each group implements
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Woverride-init"
+	Z80_FOR_EACH_GROUP(Z80_DECLARE_LABELS)
+#pragma GCC diagnostic pop
+
+	z80->opcode = opcode;
+	goto *z80MainLabels[opcode];
+
+	Z80_FOR_EACH_GROUP(Z80_DEFINE_LABELS)
+
+finished:
+	return;
+}
+
+#else
+
+typedef void (*z80_opcode_handler)(struct Z80* z80, u8 opcode);
+
+#define Z80_DISPATCH(group, next) { u8 next_opcode = (next); z80##group##Handlers[next_opcode](z80, next_opcode); }
+
+#define Z80_DECLARE_TABLE(group, name, list) static z80_opcode_handler z80##group##Handlers[0x100];
+
+#define Z80_DEFINE_HANDLER(group, op, body) \
+	static void z80##group##Op##op(struct Z80* z80, u8 opcode) { (void)opcode; body; Z80_EPILOGUE_##group; }
+
+#define Z80_DEFINE_GROUP(group, name, list) \
+	list(Z80_DEFINE_HANDLER, group) \
+	static void z80##group##Unimplemented(struct Z80* z80, u8 opcode) \
+	{ \
+		z80UnimplementedInstruction(z80, name, opcode); \
+		Z80_EPILOGUE_##group; \
 	}
+
+#define Z80_REGISTER_HANDLER(group, op, body) z80##group##Handlers[op] = z80##group##Op##op;
+
+#define Z80_BUILD_TABLE(group, name, list) \
+	for (s32 i = 0; i < 0x100; i++) \
+		z80##group##Handlers[i] = z80##group##Unimplemented; \
+	list(Z80_REGISTER_HANDLER, group)
+
+Z80_FOR_EACH_GROUP(Z80_DECLARE_TABLE)
+Z80_FOR_EACH_GROUP(Z80_DEFINE_GROUP)
+
+static void z80BuildDispatchTables()
+{
+	//tables are shared by every cpu instance and only need filling once
+	static u8 tables_built = 0;
+	if (tables_built)
+		return;
+
+	Z80_FOR_EACH_GROUP(Z80_BUILD_TABLE)
+	tables_built = 1;
 }
 
-void executeIyBitInstruction(struct Z80* z80, u8 opcode)
+void executeInstruction(struct Z80* z80, u8 opcode)
 {
-	switch (opcode) {
-		case 0x06: rlcMemIy(z80); break;
-		case 0x0E: rrcMemIy(z80); break;
-		case 0x16: rlMemIy(z80); break;
-		case 0x1E: rrMemIy(z80); break;
-		case 0x26: slaMemIy(z80); break;
-		case 0x2E: sraMemIy(z80); break;
-		case 0x3E: srlMemIy(z80); break;
-		case 0x36: sllMemIy(z80); break;
-
-		case 0x46: bitMemIy(z80, 0); break;
-		case 0x4E: bitMemIy(z80, 1); break;
-		case 0x56: bitMemIy(z80, 2); break;
-		case 0x5E: bitMemIy(z80, 3); break;
-		case 0x66: bitMemIy(z80, 4); break;
-		case 0x6E: bitMemIy(z80, 5); break;
-		case 0x76: bitMemIy(z80, 6); break;
-		case 0x7E: bitMemIy(z80, 7); break;
-
-		case 0x86: resMemIy(z80, 0); break;
-		case 0x8E: resMemIy(z80, 1); break;
-		case 0x96: resMemIy(z80, 2); break;
-		case 0x9E: resMemIy(z80, 3); break;
-		case 0xA6: resMemIy(z80, 4); break;
-		case 0xAE: resMemIy(z80, 5); break;
-		case 0xB6: resMemIy(z80, 6); break;
-		case 0xBE: resMemIy(z80, 7); break;
-
-		case 0xC6: setMemIy(z80, 0); break;
-		case 0xCE: setMemIy(z80, 1); break;
-		case 0xD6: setMemIy(z80, 2); break;
-		case 0xDE: setMemIy(z80, 3); break;
-		case 0xE6: setMemIy(z80, 4); break;
-		case 0xEE: setMemIy(z80, 5); break;
-		case 0xF6: setMemIy(z80, 6); break;
-		case 0xFE: setMemIy(z80, 7); break;
-
-	default:
-		printf("\n--Unimplemented Iy Bit Instruction--: 0x%02X\n", opcode);
-		printf("PC: 0x%04X\n", z80->pc);
-		assert(0);
-		z80->halted = 1;
-		break;
-	}
+	z80->opcode = opcode;
+	z80MainHandlers[opcode](z80, opcode);
 }
 
+#endif
+
 void loadReg16(struct Z80* z80, union Register* reg)
 {
 	reg->value = z80FetchU16(z80);
@@ -1618,12 +913,7 @@ void decReg16(struct Z80* z80, union Register* reg)
 void decReg8(struct Z80* z80, u8* reg)
 {
 	u8 result = (*reg) - 1;
-
-	z80SetFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfBorrowOccured8(*reg, 1, 0), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromSub8(*reg, 1, 0), FLAG_PV);
+	z80DeferFlags(z80, LazyDec8, *reg, 1, getFlag(z80, FLAG_C), result);
 
 	(*reg)--;
 	z80->cycles = 4;
@@ -1642,12 +932,7 @@ void decMemHl(struct Z80* z80)
 void incReg8(struct Z80* z80, u8* reg)
 {
 	u8 result = (*reg) + 1;
-
-	z80ClearFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfCarryOccured8(*reg, 1, 0), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromAdd8(*reg, 1, 0), FLAG_PV);
+	z80DeferFlags(z80, LazyInc8, *reg, 1, getFlag(z80, FLAG_C), result);
 
 	(*reg)++;
 	z80->cycles = 4;
@@ -1681,12 +966,7 @@ void addReg8(struct Z80* z80, u8* destReg, u8 sourceReg)
 	u8 dest_reg = (*destReg);
 	u8 result = dest_reg + sourceReg;
 
-	z80ClearFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfCarryOccured8(dest_reg, sourceReg, 0), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromAdd8(dest_reg, sourceReg, 0), FLAG_PV);
-	z80AffectFlag(z80, z80CarryOccured8(dest_reg, sourceReg, 0), FLAG_C);
+	z80DeferFlags(z80, LazyAdd8, dest_reg, sourceReg, 0, result);
 
 	*destReg = result;
 	z80->cycles = 4;
@@ -1730,12 +1010,7 @@ void adcReg8(struct Z80* z80, u8* destReg, u8 sourceReg)
 	u8 dest_reg = (*destReg);
 	u8 result = dest_reg + sourceReg + carry;
 
-	z80ClearFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfCarryOccured8(dest_reg, sourceReg, carry), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromAdd8(dest_reg, sourceReg, carry), FLAG_PV);
-	z80AffectFlag(z80, z80CarryOccured8(dest_reg, sourceReg, carry), FLAG_C);
+	z80DeferFlags(z80, LazyAdd8, dest_reg, sourceReg, carry, result);
 
 	*destReg = result;
 	z80->cycles = 4;
@@ -1746,12 +1021,7 @@ void subReg8(struct Z80* z80, u8* destReg, u8 sourceReg)
 	u8 dest_reg = (*destReg);
 	u8 result = dest_reg - sourceReg;
 
-	z80SetFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfBorrowOccured8(dest_reg, sourceReg, 0), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromSub8(dest_reg, sourceReg, 0), FLAG_PV);
-	z80AffectFlag(z80, z80BorrowOccured8(dest_reg, sourceReg, 0), FLAG_C);
+	z80DeferFlags(z80, LazySub8, dest_reg, sourceReg, 0, result);
 
 	*destReg = result;
 	z80->cycles = 4;
@@ -1771,12 +1041,7 @@ void sbcReg8(struct Z80* z80, u8* destReg, u8 sourceReg)
 	u8 dest_reg = (*destReg);
 	u8 result = dest_reg - sourceReg - carry;
 
-	z80SetFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfBorrowOccured8(dest_reg, sourceReg, carry), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromSub8(dest_reg, sourceReg, carry), FLAG_PV);
-	z80AffectFlag(z80, z80BorrowOccured8(dest_reg, sourceReg, carry), FLAG_C);
+	z80DeferFlags(z80, LazySub8, dest_reg, sourceReg, carry, result);
 
 	*destReg = result;
 	z80->cycles = 4;
@@ -1893,6 +1158,7 @@ void retn(struct Z80* z80)
 {
 	ret(z80);
 	z80->iff1 = z80->iff2;
+	z80->irq_line_changed = 1;
 	z80->cycles += 4;
 }
 
@@ -1933,14 +1199,9 @@ void jpMemHl(struct Z80* z80)
 
 void xor(struct Z80* z80, u8 reg)
 {
-	u8 result = z80->af.hi ^ reg;
 	z80->af.hi ^= reg;
+	z80DeferFlags(z80, LazyLogic8, 0, 0, 0, z80->af.hi);
 
-	z80AffectFlag(z80, (result == 0), FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(result), FLAG_PV);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-
-	z80ClearFlag(z80, (FLAG_C | FLAG_N | FLAG_H));
 	z80->cycles = 4;
 }
 
@@ -1954,14 +1215,9 @@ void xorMemHl(struct Z80* z80)
 
 void or(struct Z80* z80, u8 reg)
 {
-	u8 result = z80->af.hi | reg;
 	z80->af.hi |= reg;
+	z80DeferFlags(z80, LazyLogic8, 0, 0, 0, z80->af.hi);
 
-	z80AffectFlag(z80, (result == 0), FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(result), FLAG_PV);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-
-	z80ClearFlag(z80, (FLAG_C | FLAG_N | FLAG_H));
 	z80->cycles = 4;
 }
 
@@ -1975,15 +1231,8 @@ void orMemHl(struct Z80* z80)
 
 void and(struct Z80* z80, u8 reg)
 {
-	u8 result = z80->af.hi & reg;
 	z80->af.hi &= reg;
-
-	z80AffectFlag(z80, (result == 0), FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(result), FLAG_PV);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-
-	z80SetFlag(z80, FLAG_H);
-	z80ClearFlag(z80, (FLAG_C | FLAG_N));
+	z80DeferFlags(z80, LazyAnd8, 0, 0, 0, z80->af.hi);
 
 	z80->cycles = 4;
 }
@@ -2094,9 +1343,15 @@ void ex(struct Z80* z80, union Register* reg1, union Register* reg2)
 		z80->cycles += 15;
 	}
 	else {
+		if (reg1 == &z80->af)
+			z80ResolveFlags(z80);
+
 		u16 temp_reg1 = reg1->value;
 		reg1->value = reg2->value;
 		reg2->value = temp_reg1;
+
+		if (reg1 == &z80->af)
+			z80ClearFlagCopyBits(z80);
 	}
 }
 
@@ -2119,6 +1374,9 @@ void exx(struct Z80* z80)
 
 void push(struct Z80* z80, union Register* reg)
 {
+	if (reg == &z80->af)
+		z80ResolveFlags(z80);
+
 	z80->sp--;
 	z80WriteU8(z80, reg->hi, z80->sp);
 	z80->sp--;
@@ -2136,6 +1394,12 @@ void pop(struct Z80* z80, union Register* reg)
 	reg->hi = z80ReadU8(z80, z80->sp);
 	z80->sp++;
 
+	//popped F replaces whatever alu op was still pending
+	if (reg == &z80->af) {
+		z80->flags_op = LazyNone;
+		z80ClearFlagCopyBits(z80);
+	}
+
 	z80->cycles = 10;
 	if (reg == &z80->ix || reg == &z80->iy)
 		z80->cycles += 4;
@@ -2231,40 +1495,49 @@ void in(struct Z80* z80, u8 sourcePort, u8* destReg, u8 opcode)
 
 void otir(struct Z80* z80)
 {
-	z80->cycles = ((z80->bc.hi != 0) ? 21 : 16);
+	//Bytes from address hl written to port c, repeated until b is 0
+	u32 count = (z80->bc.hi == 0) ? 0x100 : z80->bc.hi;
+	u32 iterations = z80BlockIterations(z80, count);
 
-	//Byte from address hl written to port c
-	u8 value = z80ReadU8(z80, z80->hl.value);
-	u8 io_port = z80->bc.lo;
-	ioWriteU8(z80->io, value, io_port);
+	u8 values[0x100];
+	for (u32 i = 0; i < iterations; i++)
+		values[i] = z80ReadU8(z80, z80->hl.value + i);
 
-	z80->hl.value++;
-	z80->bc.hi--;
+	//io stops the block early if a write could have changed the interrupt state
+	//or the memory map, the next repeat reads the rest through the new mapping
+	u16 written = ioWriteBlock(z80->io, values, iterations, z80->bc.lo);
+	z80->hl.value += written;
+	z80->bc.hi -= written;
 
-	//If byte counter (B) is not 0, pc is decremented by 2 and the instruction
-	//will be repeated (also interrupts will be checked and possibly triggered
-	//until the instructions terminates once B becomes 0
+	//21 cycles for every repeat, 16 for the one that ends the instruction
+	z80->cycles = written * 21;
 	if (z80->bc.hi != 0)
 		z80->pc -= 2;
-	
+	else
+		z80->cycles -= 5;
+
 	z80AffectFlag(z80, z80->bc.hi == 0, FLAG_Z);
 	z80SetFlag(z80, FLAG_N);
 }
 
 void otdr(struct Z80* z80)
 {
-	z80->cycles = ((z80->bc.hi != 0) ? 21 : 16);
+	u32 count = (z80->bc.hi == 0) ? 0x100 : z80->bc.hi;
+	u32 iterations = z80BlockIterations(z80, count);
 
-	//Byte from address hl written to port c
-	u8 value = z80ReadU8(z80, z80->hl.value);
-	u8 io_port = z80->bc.lo;
-	ioWriteU8(z80->io, value, io_port);
+	u8 values[0x100];
+	for (u32 i = 0; i < iterations; i++)
+		values[i] = z80ReadU8(z80, z80->hl.value - i);
 
-	z80->hl.value--;
-	z80->bc.hi--;
+	u16 written = ioWriteBlock(z80->io, values, iterations, z80->bc.lo);
+	z80->hl.value -= written;
+	z80->bc.hi -= written;
 
+	z80->cycles = written * 21;
 	if (z80->bc.hi != 0)
 		z80->pc -= 2;
+	else
+		z80->cycles -= 5;
 
 	z80AffectFlag(z80, z80->bc.hi == 0, FLAG_Z);
 	z80SetFlag(z80, FLAG_N);
@@ -2286,22 +1559,52 @@ void ini(struct Z80* z80)
 	z80->cycles = 16;
 }
 
-void ldir(struct Z80* z80)
+void inir(struct Z80* z80)
 {
-	z80->cycles = ((z80->bc.value != 0) ? 21 : 16);
+	//Bytes from port c stored to address hl, repeated until b is 0
+	u32 count = (z80->bc.hi == 0) ? 0x100 : z80->bc.hi;
+	u32 iterations = z80BlockIterations(z80, count);
 
+	for (u32 i = 0; i < iterations; i++) {
+		u8 value = ioReadU8(z80->io, z80->bc.lo);
+		z80WriteU8(z80, value, z80->hl.value);
+
+		z80->hl.value++;
+	}
+	z80->bc.hi -= iterations;
+
+	z80->cycles = iterations * 21;
+	if (z80->bc.hi != 0)
+		z80->pc -= 2;
+	else
+		z80->cycles -= 5;
+
+	z80SetFlag(z80, FLAG_N);
+	z80AffectFlag(z80, z80->bc.hi == 0, FLAG_Z);
+}
+
+void ldir(struct Z80* z80)
+{
 	//Transfers bytes from source address hl to destination 
 	//address de, bc times
-	u8 value = z80ReadU8(z80, z80->hl.value);
-	z80WriteU8(z80, value, z80->de.value);
+	u32 count = (z80->bc.value == 0) ? 0x10000 : z80->bc.value;
+	u32 iterations = z80BlockIterations(z80, count);
 
-	z80->hl.value++;
-	z80->de.value++;
-	z80->bc.value--;
+	//byte by byte so overlapping copies and mapper writes behave as single repeats
+	for (u32 i = 0; i < iterations; i++) {
+		u8 value = z80ReadU8(z80, z80->hl.value);
+		z80WriteU8(z80, value, z80->de.value);
 
-	if (z80->bc.value != 0) {
-		z80->pc -= 2;
+		z80->hl.value++;
+		z80->de.value++;
 	}
+	z80->bc.value -= iterations;
+
+	z80->cycles = iterations * 21;
+	if (z80->bc.value != 0)
+		z80->pc -= 2;
+	else
+		z80->cycles -= 5;
 
 	z80AffectFlag(z80, z80->bc.value != 0, FLAG_PV);
 	z80ClearFlag(z80, (FLAG_N | FLAG_H));
@@ -2339,11 +1642,26 @@ void ldd(struct Z80* z80)
 
 void lddr(struct Z80* z80)
 {
-	ldd(z80);
-	if (z80->bc.value != 0) {
-		z80->pc -= 2;
-		z80->cycles += 5;
+	u32 count = (z80->bc.value == 0) ? 0x10000 : z80->bc.value;
+	u32 iterations = z80BlockIterations(z80, count);
+
+	for (u32 i = 0; i < iterations; i++) {
+		u8 value = z80ReadU8(z80, z80->hl.value);
+		z80WriteU8(z80, value, z80->de.value);
+
+		z80->hl.value--;
+		z80->de.value--;
 	}
+	z80->bc.value -= iterations;
+
+	z80->cycles = iterations * 21;
+	if (z80->bc.value != 0)
+		z80->pc -= 2;
+	else
+		z80->cycles -= 5;
+
+	z80ClearFlag(z80, (FLAG_H | FLAG_N));
+	z80AffectFlag(z80, z80->bc.value != 0, FLAG_PV);
 }
 
 void rrd(struct Z80* z80)
@@ -2399,13 +1717,7 @@ void halt(struct Z80* z80)
 void cp(struct Z80* z80, u8 reg)
 {
 	u8 result = z80->af.hi - reg;
-
-	z80SetFlag(z80, FLAG_N);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80OverflowFromSub8(z80->af.hi, reg, 0), FLAG_PV);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, z80BorrowOccured8(z80->af.hi, reg, 0), FLAG_C);
-	z80AffectFlag(z80, z80HalfBorrowOccured8(z80->af.hi, reg, 0), FLAG_H);
+	z80DeferFlags(z80, LazySub8, z80->af.hi, reg, 0, result);
 
 	z80->cycles = 4;
 }
@@ -2476,13 +1788,7 @@ void ccf(struct Z80* z80)
 void neg(struct Z80* z80)
 {
 	u8 result = 0 - z80->af.hi;
-
-	z80SetFlag(z80, FLAG_N);
-	z80AffectFlag(z80, z80IsSigned8(result), FLAG_S);
-	z80AffectFlag(z80, result == 0, FLAG_Z);
-	z80AffectFlag(z80, z80HalfBorrowOccured8(0, z80->af.hi, 0), FLAG_H);
-	z80AffectFlag(z80, z80OverflowFromSub8(0, z80->af.hi, 0), FLAG_PV);
-	z80AffectFlag(z80, z80BorrowOccured8(0, z80->af.hi, 0), FLAG_C);
+	z80DeferFlags(z80, LazySub8, 0, z80->af.hi, 0, result);
 
 	z80->af.hi = result;
 	z80->cycles = 8;
@@ -2553,22 +1859,13 @@ void rlc(struct Z80* z80, u8* reg)
 	u8 reg_value = (*reg);
 	u8 msb = (reg_value >> 7) & 0x1;
 
+	//Old bit 7 moved to bit 0 and into carry
 	reg_value <<= 1;
+	reg_value |= msb;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (msb) {
-		z80SetFlag(z80, FLAG_C);
-		reg_value = setBit(reg_value, 0);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-		reg_value = clearBit(reg_value, 0);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, msb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2592,18 +1889,9 @@ void rl(struct Z80* z80, u8* reg)
 	reg_value <<= 1;
 	reg_value |= carry;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (msb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, msb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2623,22 +1911,13 @@ void rrc(struct Z80* z80, u8* reg)
 	u8 reg_value = (*reg);
 	u8 lsb = (reg_value & 0x1);
 
+	//Old bit 0 moved to bit 7 and into carry
 	reg_value >>= 1;
+	reg_value |= (lsb << 7);
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (lsb) {
-		z80SetFlag(z80, FLAG_C);
-		reg_value = setBit(reg_value, 7);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-		reg_value = clearBit(reg_value, 7);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, lsb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2652,18 +1931,9 @@ void rr(struct Z80* z80, u8* reg)
 	reg_value >>= 1;
 	reg_value |= (carry << 7);
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (lsb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, lsb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2695,18 +1965,9 @@ void sla(struct Z80* z80, u8* reg)
 
 	reg_value <<= 1;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (msb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, msb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2730,18 +1991,9 @@ void sra(struct Z80* z80, u8* reg)
 	reg_value >>= 1;
 	reg_value |= sign;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (lsb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, lsb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2763,18 +2015,9 @@ void srl(struct Z80* z80, u8* reg)
 
 	reg_value >>= 1;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (lsb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, lsb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -2797,18 +2040,9 @@ void sll(struct Z80* z80, u8* reg)
 	reg_value <<= 1;
 	reg_value |= 0x1;
 
-	z80ClearFlag(z80, (FLAG_N | FLAG_H));
-	if (msb) {
-		z80SetFlag(z80, FLAG_C);
-	}
-	else {
-		z80ClearFlag(z80, FLAG_C);
-	}
 	(*reg) = reg_value;
 
-	z80AffectFlag(z80, z80IsSigned8(reg_value), FLAG_S);
-	z80AffectFlag(z80, reg_value == 0, FLAG_Z);
-	z80AffectFlag(z80, z80IsEvenParity(reg_value), FLAG_PV);
+	z80DeferFlags(z80, LazyLogic8, 0, 0, msb, reg_value);
 
 	z80->cycles = 8;
 }
@@ -3431,11 +2665,13 @@ void ei(struct Z80* z80)
 	z80->iff1 = 1;
 	z80->iff2 = 1;
 	z80->process_interrupt_delay = 1;
+	z80->irq_line_changed = 1;
 	z80->cycles = 4;
 }
 
 void im(struct Z80* z80, enum IntMode interruptMode)
 {
 	z80->interrupt_mode = interruptMode;
+	z80->irq_line_changed = 1;
 	z80->cycles = 8;
 }
@@ -9,6 +9,11 @@
 #define FLAG_Z (1 << 6)
 #define FLAG_S (1 << 7)
 
+//Defer flag computation for alu ops until F is read, set to 0 to build F eagerly
+#define Z80_LAZY_FLAGS 1
+//Look up alu flags in tables generated at startup instead of computing them per bit
+#define Z80_FLAG_TABLES 1
+
 #define NMI_VECTOR 0x66
 #define INT_VECTOR 0x38
 
@@ -44,6 +49,17 @@ enum IntMode {
 	Zero, One, Two
 };
 
+//Alu ops whose flags can be deferred until F is read
+enum LazyFlagsOp {
+	LazyNone, //F in af.lo is up to date
+	LazyAdd8, //add, adc
+	LazySub8, //sub, sbc, cp, neg
+	LazyInc8,
+	LazyDec8,
+	LazyAnd8,
+	LazyLogic8 //or, xor, rotates and shifts (carry holds the shifted out bit)
+};
+
 struct Z80 {
 	struct ShadowedRegisters shadowedregs;
 	union Register af;
@@ -62,6 +78,19 @@ struct Z80 {
 	u8 iff1;
 	u8 iff2;
 	u8 process_interrupt_delay; //flag used for instruction delay after ei is executed
+	u8 irq_line_changed; //ends a z80Run batch so interrupts can be serviced
+	u32 block_budget; //cycles left in the z80Run batch, lets block instructions repeat in one call
+	u32 run_cycles; //cycles into the z80Run batch when the current instruction started
+
+	//Idle loop fast forward, state of the last backward branch seen in a batch
+	u8 idle_loop_armed;
+	u16 idle_loop_pc;
+	u16 idle_loop_af;
+	u32 idle_loop_cycles;
+
+	//Cycles fast forwarded instead of executed
+	u64 halt_skipped_cycles;
+	u64 idle_skipped_cycles;
 	u8 halted;
 	u8 irq_requested;
 
@@ -70,6 +99,14 @@ struct Z80 {
 	u8 opcode;
 	u8 ext_opcode;
 
+	//Operands of the last deferred alu op, carry is the carry in for add/sub
+	//and the untouched carry for inc/dec
+	enum LazyFlagsOp flags_op;
+	u8 flags_op1;
+	u8 flags_op2;
+	u8 flags_carry;
+	u8 flags_result;
+
 	struct Bus* bus;
 	struct Io* io;
 
@@ -88,6 +125,8 @@ void z80SetFlag(struct Z80* z80, u8 flags);
 void z80ClearFlag(struct Z80* z80, u8 flags);
 void z80ClearFlagCopyBits(struct Z80* z80);
 u8 getFlag(struct Z80* z80, u8 flag);
+void z80DeferFlags(struct Z80* z80, enum LazyFlagsOp op, u8 op1, u8 op2, u8 carry, u8 result);
+void z80ResolveFlags(struct Z80* z80);
 
 void z80HandleInterrupts(struct Z80* z80, struct Vdp *vdp);
 void z80RequestIrq(struct System* sys);
@@ -119,18 +158,13 @@ u8 z80FetchU8(struct Z80 *z80);
 u16 z80ReadU16(struct Z80* z80, u16 address);
 u16 z80FetchU16(struct Z80* z80);
 u16 z80Clock(struct Z80* z80);
+u32 z80Run(struct Z80* z80, s32 cycle_budget);
+u8 z80IsIdleLoop(struct Z80* z80, u16 loop_start, u16 branch_pc);
+u32 z80SkipIdleLoop(struct Z80* z80, u16 branch_pc, u32 cycles, s32 cycle_budget);
+u32 z80BlockIterations(struct Z80* z80, u32 count);
 
+//Decodes through the per prefix tables built from Z80Opcodes.h
 void executeInstruction(struct Z80* z80, u8 opcode);
-void executeMainInstruction(struct Z80* z80, u8 opcode);
-void executeBitInstruction(struct Z80* z80, u8 opcode);
-
-void executeIxInstruction(struct Z80* z80, u8 opcode);
-void executeIxBitInstruction(struct Z80* z80, u8 opcode);
-
-void executeExtendedInstruction(struct Z80* z80, u8 opcode);
-
-void executeIyInstruction(struct Z80* z80, u8 opcode);
-void executeIyBitInstruction(struct Z80* z80, u8 opcode);
 
 //Loads
 void loadReg16(struct Z80* z80, union Register *reg);
@@ -219,6 +253,7 @@ void in(struct Z80* z80, u8 sourcePort, u8* destReg, u8 opcode);
 void otir(struct Z80* z80);
 void otdr(struct Z80* z80);
 void ini(struct Z80* z80);
+void inir(struct Z80* z80);
 void ldir(struct Z80* z80);
 void ldi(struct Z80* z80);
 void ldd(struct Z80* z80);
@@ -0,0 +1,925 @@
+#pragma once
+
+/*
+	Opcode lists for each prefix group, used to build the dispatch tables in Z80.c.
+	Each entry is OP(group, opcode, body) where body is run with z80 in scope
+	(and opcode holding the byte that selected the entry).
+
+	Group		Prefix
+	Main		none
+	Bit			CB
+	Ix			DD
+	IxBit		DD CB
+	Extended	ED
+	Iy			FD
+	IyBit		FD CB
+
+	Z80_DISPATCH(group, opcode) continues decoding in another group's table.
+*/
+
+#define Z80_MAIN_OPCODES(OP, group) \
+	/* Prefixes */ \
+	OP(group, 0xCB, Z80_DISPATCH(Bit, z80ReadU8(z80, z80->pc++))) \
+	OP(group, 0xDD, Z80_DISPATCH(Ix, z80ReadU8(z80, z80->pc++))) \
+	OP(group, 0xED, z80->ext_opcode = z80ReadU8(z80, z80->pc++); Z80_DISPATCH(Extended, z80->ext_opcode)) \
+	OP(group, 0xFD, Z80_DISPATCH(Iy, z80ReadU8(z80, z80->pc++))) \
+	OP(group, 0x00, z80->cycles = 4) \
+	/* Load immediate u16 into register */ \
+	OP(group, 0x01, loadReg16(z80, &z80->bc)) \
+	OP(group, 0x11, loadReg16(z80, &z80->de)) \
+	OP(group, 0x21, loadReg16(z80, &z80->hl)) \
+	OP(group, 0x31, loadReg16(z80, &z80->sp)) \
+	OP(group, 0xF9, loadSpReg(z80, &z80->hl)) \
+	/* Misc */ \
+	OP(group, 0x2F, cpl(z80)) \
+	OP(group, 0x76, halt(z80)) \
+	OP(group, 0xFE, cp(z80, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0x27, daa(z80)) \
+	OP(group, 0x3F, ccf(z80)) \
+	OP(group, 0x37, scf(z80)) \
+	/* Shifts */ \
+	OP(group, 0x07, rlca(z80)) \
+	OP(group, 0x0F, rrca(z80)) \
+	OP(group, 0x17, rla(z80)) \
+	OP(group, 0x1F, rra(z80)) \
+	/* Exchanges */ \
+	OP(group, 0x08, ex(z80, &z80->af, &z80->shadowedregs.af)) \
+	OP(group, 0xE3, ex(z80, &z80->sp, &z80->hl)) \
+	OP(group, 0xEB, ex(z80, &z80->de, &z80->hl)) \
+	OP(group, 0xD9, exx(z80)) \
+	/* Loads */ \
+	/* Register pointer loads */ \
+	OP(group, 0x0A, loadRegMem(z80, &z80->af.hi, &z80->bc)) \
+	OP(group, 0x1A, loadRegMem(z80, &z80->af.hi, &z80->de)) \
+	OP(group, 0x02, loadReg8Mem(z80, z80->bc, z80->af.hi)) \
+	OP(group, 0x12, loadReg8Mem(z80, z80->de, z80->af.hi)) \
+	OP(group, 0x22, loadMemReg16(z80, &z80->hl)) \
+	OP(group, 0x32, loadMemReg8(z80, z80->af.hi)) \
+	OP(group, 0x06, loadReg8(z80, &z80->bc.hi)) \
+	OP(group, 0x0E, loadReg8(z80, &z80->bc.lo)) \
+	OP(group, 0x16, loadReg8(z80, &z80->de.hi)) \
+	OP(group, 0x1E, loadReg8(z80, &z80->de.lo)) \
+	OP(group, 0x26, loadReg8(z80, &z80->hl.hi)) \
+	OP(group, 0x2E, loadReg8(z80, &z80->hl.lo)) \
+	OP(group, 0x3E, loadReg8(z80, &z80->af.hi)) \
+	OP(group, 0x36, loadHL8(z80)) \
+	OP(group, 0x2A, load16Reg(z80, &z80->hl)) \
+	OP(group, 0x3A, load16A(z80)) \
+	/* Load src reg into dest reg */ \
+	OP(group, 0x40, loadReg(z80, &z80->bc.hi, z80->bc.hi)) \
+	OP(group, 0x41, loadReg(z80, &z80->bc.hi, z80->bc.lo)) \
+	OP(group, 0x42, loadReg(z80, &z80->bc.hi, z80->de.hi)) \
+	OP(group, 0x43, loadReg(z80, &z80->bc.hi, z80->de.lo)) \
+	OP(group, 0x44, loadReg(z80, &z80->bc.hi, z80->hl.hi)) \
+	OP(group, 0x45, loadReg(z80, &z80->bc.hi, z80->hl.lo)) \
+	OP(group, 0x47, loadReg(z80, &z80->bc.hi, z80->af.hi)) \
+	OP(group, 0x48, loadReg(z80, &z80->bc.lo, z80->bc.hi)) \
+	OP(group, 0x49, loadReg(z80, &z80->bc.lo, z80->bc.lo)) \
+	OP(group, 0x4A, loadReg(z80, &z80->bc.lo, z80->de.hi)) \
+	OP(group, 0x4B, loadReg(z80, &z80->bc.lo, z80->de.lo)) \
+	OP(group, 0x4C, loadReg(z80, &z80->bc.lo, z80->hl.hi)) \
+	OP(group, 0x4D, loadReg(z80, &z80->bc.lo, z80->hl.lo)) \
+	OP(group, 0x4F, loadReg(z80, &z80->bc.lo, z80->af.hi)) \
+	OP(group, 0x50, loadReg(z80, &z80->de.hi, z80->bc.hi)) \
+	OP(group, 0x51, loadReg(z80, &z80->de.hi, z80->bc.lo)) \
+	OP(group, 0x52, loadReg(z80, &z80->de.hi, z80->de.hi)) \
+	OP(group, 0x53, loadReg(z80, &z80->de.hi, z80->de.lo)) \
+	OP(group, 0x54, loadReg(z80, &z80->de.hi, z80->hl.hi)) \
+	OP(group, 0x55, loadReg(z80, &z80->de.hi, z80->hl.lo)) \
+	OP(group, 0x57, loadReg(z80, &z80->de.hi, z80->af.hi)) \
+	OP(group, 0x58, loadReg(z80, &z80->de.lo, z80->bc.hi)) \
+	OP(group, 0x59, loadReg(z80, &z80->de.lo, z80->bc.lo)) \
+	OP(group, 0x5A, loadReg(z80, &z80->de.lo, z80->de.hi)) \
+	OP(group, 0x5B, loadReg(z80, &z80->de.lo, z80->de.lo)) \
+	OP(group, 0x5C, loadReg(z80, &z80->de.lo, z80->hl.hi)) \
+	OP(group, 0x5D, loadReg(z80, &z80->de.lo, z80->hl.lo)) \
+	OP(group, 0x5F, loadReg(z80, &z80->de.lo, z80->af.hi)) \
+	OP(group, 0x60, loadReg(z80, &z80->hl.hi, z80->bc.hi)) \
+	OP(group, 0x61, loadReg(z80, &z80->hl.hi, z80->bc.lo)) \
+	OP(group, 0x62, loadReg(z80, &z80->hl.hi, z80->de.hi)) \
+	OP(group, 0x63, loadReg(z80, &z80->hl.hi, z80->de.lo)) \
+	OP(group, 0x64, loadReg(z80, &z80->hl.hi, z80->hl.hi)) \
+	OP(group, 0x65, loadReg(z80, &z80->hl.hi, z80->hl.lo)) \
+	OP(group, 0x67, loadReg(z80, &z80->hl.hi, z80->af.hi)) \
+	OP(group, 0x68, loadReg(z80, &z80->hl.lo, z80->bc.hi)) \
+	OP(group, 0x69, loadReg(z80, &z80->hl.lo, z80->bc.lo)) \
+	OP(group, 0x6A, loadReg(z80, &z80->hl.lo, z80->de.hi)) \
+	OP(group, 0x6B, loadReg(z80, &z80->hl.lo, z80->de.lo)) \
+	OP(group, 0x6C, loadReg(z80, &z80->hl.lo, z80->hl.hi)) \
+	OP(group, 0x6D, loadReg(z80, &z80->hl.lo, z80->hl.lo)) \
+	OP(group, 0x6F, loadReg(z80, &z80->hl.lo, z80->af.hi)) \
+	OP(group, 0x78, loadAReg(z80, z80->bc.hi)) \
+	OP(group, 0x79, loadAReg(z80, z80->bc.lo)) \
+	OP(group, 0x7A, loadAReg(z80, z80->de.hi)) \
+	OP(group, 0x7B, loadAReg(z80, z80->de.lo)) \
+	OP(group, 0x7C, loadAReg(z80, z80->hl.hi)) \
+	OP(group, 0x7D, loadAReg(z80, z80->hl.lo)) \
+	OP(group, 0x7F, loadAReg(z80, z80->af.hi)) \
+	OP(group, 0x46, loadRegHl(z80, &z80->bc.hi)) \
+	OP(group, 0x4E, loadRegHl(z80, &z80->bc.lo)) \
+	OP(group, 0x56, loadRegHl(z80, &z80->de.hi)) \
+	OP(group, 0x5E, loadRegHl(z80, &z80->de.lo)) \
+	OP(group, 0x66, loadRegHl(z80, &z80->hl.hi)) \
+	OP(group, 0x6E, loadRegHl(z80, &z80->hl.lo)) \
+	OP(group, 0x7E, loadRegHl(z80, &z80->af.hi)) \
+	OP(group, 0x70, loadHlReg(z80, z80->bc.hi)) \
+	OP(group, 0x71, loadHlReg(z80, z80->bc.lo)) \
+	OP(group, 0x72, loadHlReg(z80, z80->de.hi)) \
+	OP(group, 0x73, loadHlReg(z80, z80->de.lo)) \
+	OP(group, 0x74, loadHlReg(z80, z80->hl.hi)) \
+	OP(group, 0x75, loadHlReg(z80, z80->hl.lo)) \
+	OP(group, 0x77, loadHlReg(z80, z80->af.hi)) \
+	/* Arithmetic */ \
+	OP(group, 0x19, addReg16(z80, &z80->hl, &z80->de)) \
+	OP(group, 0x09, addReg16(z80, &z80->hl, &z80->bc)) \
+	OP(group, 0x29, addReg16(z80, &z80->hl, &z80->hl)) \
+	OP(group, 0x39, addReg16(z80, &z80->hl, &z80->sp)) \
+	OP(group, 0x03, incReg16(z80, &z80->bc)) \
+	OP(group, 0x13, incReg16(z80, &z80->de)) \
+	OP(group, 0x23, incReg16(z80, &z80->hl)) \
+	OP(group, 0x33, incReg16(z80, &z80->sp)) \
+	OP(group, 0x0B, decReg16(z80, &z80->bc)) \
+	OP(group, 0x1B, decReg16(z80, &z80->de)) \
+	OP(group, 0x2B, decReg16(z80, &z80->hl)) \
+	OP(group, 0x3B, decReg16(z80, &z80->sp)) \
+	OP(group, 0x05, decReg8(z80, &z80->bc.hi)) \
+	OP(group, 0x15, decReg8(z80, &z80->de.hi)) \
+	OP(group, 0x25, decReg8(z80, &z80->hl.hi)) \
+	OP(group, 0x0D, decReg8(z80, &z80->bc.lo)) \
+	OP(group, 0x1D, decReg8(z80, &z80->de.lo)) \
+	OP(group, 0x2D, decReg8(z80, &z80->hl.lo)) \
+	OP(group, 0x3D, decReg8(z80, &z80->af.hi)) \
+	OP(group, 0x35, decMemHl(z80)) \
+	OP(group, 0x04, incReg8(z80, &z80->bc.hi)) \
+	OP(group, 0x0C, incReg8(z80, &z80->bc.lo)) \
+	OP(group, 0x14, incReg8(z80, &z80->de.hi)) \
+	OP(group, 0x1C, incReg8(z80, &z80->de.lo)) \
+	OP(group, 0x24, incReg8(z80, &z80->hl.hi)) \
+	OP(group, 0x2C, incReg8(z80, &z80->hl.lo)) \
+	OP(group, 0x3C, incReg8(z80, &z80->af.hi)) \
+	OP(group, 0x34, incMemHl(z80)) \
+	/* 8 bit reg add */ \
+	OP(group, 0x80, addReg8(z80, &z80->af.hi, z80->bc.hi)) \
+	OP(group, 0x81, addReg8(z80, &z80->af.hi, z80->bc.lo)) \
+	OP(group, 0x82, addReg8(z80, &z80->af.hi, z80->de.hi)) \
+	OP(group, 0x83, addReg8(z80, &z80->af.hi, z80->de.lo)) \
+	OP(group, 0x84, addReg8(z80, &z80->af.hi, z80->hl.hi)) \
+	OP(group, 0x85, addReg8(z80, &z80->af.hi, z80->hl.lo)) \
+	OP(group, 0x86, addMemHl(z80, &z80->af.hi)) \
+	OP(group, 0x87, addReg8(z80, &z80->af.hi, z80->af.hi)) \
+	OP(group, 0xC6, addReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0x88, adcReg8(z80, &z80->af.hi, z80->bc.hi)) \
+	OP(group, 0x89, adcReg8(z80, &z80->af.hi, z80->bc.lo)) \
+	OP(group, 0x8A, adcReg8(z80, &z80->af.hi, z80->de.hi)) \
+	OP(group, 0x8B, adcReg8(z80, &z80->af.hi, z80->de.lo)) \
+	OP(group, 0x8C, adcReg8(z80, &z80->af.hi, z80->hl.hi)) \
+	OP(group, 0x8D, adcReg8(z80, &z80->af.hi, z80->hl.lo)) \
+	OP(group, 0x8E, adcMemHl(z80, &z80->af.hi)) \
+	OP(group, 0x8F, adcReg8(z80, &z80->af.hi, z80->af.hi)) \
+	OP(group, 0xCE, adcReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3) \
+	/* 8 bit reg sub */ \
+	OP(group, 0x90, subReg8(z80, &z80->af.hi, z80->bc.hi)) \
+	OP(group, 0x91, subReg8(z80, &z80->af.hi, z80->bc.lo)) \
+	OP(group, 0x92, subReg8(z80, &z80->af.hi, z80->de.hi)) \
+	OP(group, 0x93, subReg8(z80, &z80->af.hi, z80->de.lo)) \
+	OP(group, 0x94, subReg8(z80, &z80->af.hi, z80->hl.hi)) \
+	OP(group, 0x95, subReg8(z80, &z80->af.hi, z80->hl.lo)) \
+	OP(group, 0x96, subMemHl(z80, &z80->af.hi)) \
+	OP(group, 0x97, subReg8(z80, &z80->af.hi, z80->af.hi)) \
+	OP(group, 0xD6, subReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0x98, sbcReg8(z80, &z80->af.hi, z80->bc.hi)) \
+	OP(group, 0x99, sbcReg8(z80, &z80->af.hi, z80->bc.lo)) \
+	OP(group, 0x9A, sbcReg8(z80, &z80->af.hi, z80->de.hi)) \
+	OP(group, 0x9B, sbcReg8(z80, &z80->af.hi, z80->de.lo)) \
+	OP(group, 0x9C, sbcReg8(z80, &z80->af.hi, z80->hl.hi)) \
+	OP(group, 0x9D, sbcReg8(z80, &z80->af.hi, z80->hl.lo)) \
+	OP(group, 0x9E, sbcMemHl(z80, &z80->af.hi)) \
+	OP(group, 0x9F, sbcReg8(z80, &z80->af.hi, z80->af.hi)) \
+	OP(group, 0xDE, sbcReg8(z80, &z80->af.hi, z80FetchU8(z80)); z80->cycles += 3) \
+	/* Jumps/Branches/Rets */ \
+	OP(group, 0x10, djnz(z80)) \
+	OP(group, 0x18, jrImm(z80)) \
+	OP(group, 0x20, jrImmCond(z80, getFlag(z80, FLAG_Z) == 0)) \
+	OP(group, 0x28, jrImmCond(z80, getFlag(z80, FLAG_Z))) \
+	OP(group, 0x30, jrImmCond(z80, getFlag(z80, FLAG_C) == 0)) \
+	OP(group, 0x38, jrImmCond(z80, getFlag(z80, FLAG_C))) \
+	/* Logical */ \
+	OP(group, 0xA0, and(z80, z80->bc.hi)) \
+	OP(group, 0xA1, and(z80, z80->bc.lo)) \
+	OP(group, 0xA2, and(z80, z80->de.hi)) \
+	OP(group, 0xA3, and(z80, z80->de.lo)) \
+	OP(group, 0xA4, and(z80, z80->hl.hi)) \
+	OP(group, 0xA5, and(z80, z80->hl.lo)) \
+	OP(group, 0xA6, andMemHl(z80)) \
+	OP(group, 0xA7, and(z80, z80->af.hi)) \
+	OP(group, 0xE6, and(z80, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0xA8, xor(z80, z80->bc.hi)) \
+	OP(group, 0xA9, xor(z80, z80->bc.lo)) \
+	OP(group, 0xAA, xor(z80, z80->de.hi)) \
+	OP(group, 0xAB, xor(z80, z80->de.lo)) \
+	OP(group, 0xAC, xor(z80, z80->hl.hi)) \
+	OP(group, 0xAD, xor(z80, z80->hl.lo)) \
+	OP(group, 0xAE, xorMemHl(z80)) \
+	OP(group, 0xAF, xor(z80, z80->af.hi)) \
+	OP(group, 0xEE, xor(z80, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0xB0, or(z80, z80->bc.hi)) \
+	OP(group, 0xB1, or(z80, z80->bc.lo)) \
+	OP(group, 0xB2, or(z80, z80->de.hi)) \
+	OP(group, 0xB3, or(z80, z80->de.lo)) \
+	OP(group, 0xB4, or(z80, z80->hl.hi)) \
+	OP(group, 0xB5, or(z80, z80->hl.lo)) \
+	OP(group, 0xB6, orMemHl(z80)) \
+	OP(group, 0xB7, or(z80, z80->af.hi)) \
+	OP(group, 0xF6, or(z80, z80FetchU8(z80)); z80->cycles += 3) \
+	OP(group, 0xB8, cp(z80, z80->bc.hi)) \
+	OP(group, 0xB9, cp(z80, z80->bc.lo)) \
+	OP(group, 0xBA, cp(z80, z80->de.hi)) \
+	OP(group, 0xBB, cp(z80, z80->de.lo)) \
+	OP(group, 0xBC, cp(z80, z80->hl.hi)) \
+	OP(group, 0xBD, cp(z80, z80->hl.lo)) \
+	OP(group, 0xBE, cpMemHl(z80)) \
+	OP(group, 0xBF, cp(z80, z80->af.hi)) \
+	OP(group, 0xCC, callCond(z80, getFlag(z80, FLAG_Z))) \
+	OP(group, 0xCD, call(z80)) \
+	OP(group, 0xC4, callCond(z80, getFlag(z80, FLAG_Z) == 0)) \
+	OP(group, 0xD4, callCond(z80, getFlag(z80, FLAG_C) == 0)) \
+	OP(group, 0xDC, callCond(z80, getFlag(z80, FLAG_C))) \
+	OP(group, 0xE4, callCond(z80, getFlag(z80, FLAG_PV) == 0)) \
+	OP(group, 0xEC, callCond(z80, getFlag(z80, FLAG_PV))) \
+	OP(group, 0xF4, callCond(z80, getFlag(z80, FLAG_S) == 0)) \
+	OP(group, 0xFC, callCond(z80, getFlag(z80, FLAG_S))) \
+	OP(group, 0xC0, retCond(z80, getFlag(z80, FLAG_Z) == 0)) \
+	OP(group, 0xC8, retCond(z80, getFlag(z80, FLAG_Z))) \
+	OP(group, 0xC9, ret(z80)) \
+	OP(group, 0xD0, retCond(z80, getFlag(z80, FLAG_C) == 0)) \
+	OP(group, 0xD8, retCond(z80, getFlag(z80, FLAG_C))) \
+	OP(group, 0xE0, retCond(z80, getFlag(z80, FLAG_PV) == 0)) \
+	OP(group, 0xE8, retCond(z80, getFlag(z80, FLAG_PV))) \
+	OP(group, 0xF0, retCond(z80, getFlag(z80, FLAG_S) == 0)) \
+	OP(group, 0xF8, retCond(z80, getFlag(z80, FLAG_S))) \
+	/* Jumps */ \
+	OP(group, 0xC2, jpCond(z80, getFlag(z80, FLAG_Z) == 0)) \
+	OP(group, 0xC3, jp(z80)) \
+	OP(group, 0xCA, jpCond(z80, getFlag(z80, FLAG_Z))) \
+	OP(group, 0xD2, jpCond(z80, getFlag(z80, FLAG_C) == 0)) \
+	OP(group, 0xDA, jpCond(z80, getFlag(z80, FLAG_C))) \
+	OP(group, 0xE2, jpCond(z80, getFlag(z80, FLAG_PV) == 0)) \
+	OP(group, 0xE9, jpMemHl(z80)) \
+	OP(group, 0xEA, jpCond(z80, getFlag(z80, FLAG_PV))) \
+	OP(group, 0xF2, jpCond(z80, getFlag(z80, FLAG_S) == 0)) \
+	OP(group, 0xFA, jpCond(z80, getFlag(z80, FLAG_S))) \
+	/* Restarts */ \
+	OP(group, 0xC7, rst(z80, 0x00)) \
+	OP(group, 0xCF, rst(z80, 0x08)) \
+	OP(group, 0xD7, rst(z80, 0x10)) \
+	OP(group, 0xDF, rst(z80, 0x18)) \
+	OP(group, 0xE7, rst(z80, 0x20)) \
+	OP(group, 0xEF, rst(z80, 0x28)) \
+	OP(group, 0xF7, rst(z80, 0x30)) \
+	OP(group, 0xFF, rst(z80, 0x38)) \
+	OP(group, 0xD3, outa(z80)) \
+	OP(group, 0xDB, ina(z80)) \
+	OP(group, 0xC5, push(z80, &z80->bc)) \
+	OP(group, 0xD5, push(z80, &z80->de)) \
+	OP(group, 0xE5, push(z80, &z80->hl)) \
+	OP(group, 0xF5, push(z80, &z80->af)) \
+	OP(group, 0xC1, pop(z80, &z80->bc)) \
+	OP(group, 0xD1, pop(z80, &z80->de)) \
+	OP(group, 0xE1, pop(z80, &z80->hl)) \
+	OP(group, 0xF1, pop(z80, &z80->af)) \
+	OP(group, 0xF3, di(z80)) \
+	OP(group, 0xFB, ei(z80))
+
+#define Z80_BIT_OPCODES(OP, group) \
+	OP(group, 0x00, rlc(z80, &z80->bc.hi)) \
+	OP(group, 0x01, rlc(z80, &z80->bc.lo)) \
+	OP(group, 0x02, rlc(z80, &z80->de.hi)) \
+	OP(group, 0x03, rlc(z80, &z80->de.lo)) \
+	OP(group, 0x04, rlc(z80, &z80->hl.hi)) \
+	OP(group, 0x05, rlc(z80, &z80->hl.lo)) \
+	OP(group, 0x06, rlcMemHl(z80)) \
+	OP(group, 0x07, rlc(z80, &z80->af.hi)) \
+	OP(group, 0x08, rrc(z80, &z80->bc.hi)) \
+	OP(group, 0x09, rrc(z80, &z80->bc.lo)) \
+	OP(group, 0x0A, rrc(z80, &z80->de.hi)) \
+	OP(group, 0x0B, rrc(z80, &z80->de.lo)) \
+	OP(group, 0x0C, rrc(z80, &z80->hl.hi)) \
+	OP(group, 0x0D, rrc(z80, &z80->hl.lo)) \
+	OP(group, 0x0E, rrcMemHl(z80)) \
+	OP(group, 0x0F, rrc(z80, &z80->af.hi)) \
+	OP(group, 0x10, rl(z80, &z80->bc.hi)) \
+	OP(group, 0x11, rl(z80, &z80->bc.lo)) \
+	OP(group, 0x12, rl(z80, &z80->de.hi)) \
+	OP(group, 0x13, rl(z80, &z80->de.lo)) \
+	OP(group, 0x14, rl(z80, &z80->hl.hi)) \
+	OP(group, 0x15, rl(z80, &z80->hl.lo)) \
+	OP(group, 0x16, rlMemHl(z80)) \
+	OP(group, 0x17, rl(z80, &z80->af.hi)) \
+	OP(group, 0x18, rr(z80, &z80->bc.hi)) \
+	OP(group, 0x19, rr(z80, &z80->bc.lo)) \
+	OP(group, 0x1A, rr(z80, &z80->de.hi)) \
+	OP(group, 0x1B, rr(z80, &z80->de.lo)) \
+	OP(group, 0x1C, rr(z80, &z80->hl.hi)) \
+	OP(group, 0x1D, rr(z80, &z80->hl.lo)) \
+	OP(group, 0x1E, rrMemHl(z80)) \
+	OP(group, 0x1F, rr(z80, &z80->af.hi)) \
+	OP(group, 0x20, sla(z80, &z80->bc.hi)) \
+	OP(group, 0x21, sla(z80, &z80->bc.lo)) \
+	OP(group, 0x22, sla(z80, &z80->de.hi)) \
+	OP(group, 0x23, sla(z80, &z80->de.lo)) \
+	OP(group, 0x24, sla(z80, &z80->hl.hi)) \
+	OP(group, 0x25, sla(z80, &z80->hl.lo)) \
+	OP(group, 0x26, slaMemHl(z80)) \
+	OP(group, 0x27, sla(z80, &z80->af.hi)) \
+	OP(group, 0x28, sra(z80, &z80->bc.hi)) \
+	OP(group, 0x29, sra(z80, &z80->bc.lo)) \
+	OP(group, 0x2A, sra(z80, &z80->de.hi)) \
+	OP(group, 0x2B, sra(z80, &z80->de.lo)) \
+	OP(group, 0x2C, sra(z80, &z80->hl.hi)) \
+	OP(group, 0x2D, sra(z80, &z80->hl.lo)) \
+	OP(group, 0x2E, sraMemHl(z80)) \
+	OP(group, 0x2F, sra(z80, &z80->af.hi)) \
+	OP(group, 0x30, sll(z80, &z80->bc.hi)) \
+	OP(group, 0x31, sll(z80, &z80->bc.lo)) \
+	OP(group, 0x32, sll(z80, &z80->de.hi)) \
+	OP(group, 0x33, sll(z80, &z80->de.lo)) \
+	OP(group, 0x34, sll(z80, &z80->hl.hi)) \
+	OP(group, 0x35, sll(z80, &z80->hl.lo)) \
+	OP(group, 0x36, sllMemHl(z80)) \
+	OP(group, 0x37, sll(z80, &z80->af.hi)) \
+	/* srl */ \
+	OP(group, 0x38, srl(z80, &z80->bc.hi)) \
+	OP(group, 0x39, srl(z80, &z80->bc.lo)) \
+	OP(group, 0x3A, srl(z80, &z80->de.hi)) \
+	OP(group, 0x3B, srl(z80, &z80->de.lo)) \
+	OP(group, 0x3C, srl(z80, &z80->hl.hi)) \
+	OP(group, 0x3D, srl(z80, &z80->hl.lo)) \
+	OP(group, 0x3E, srlMemHl(z80)) \
+	OP(group, 0x3F, srl(z80, &z80->af.hi)) \
+	/* Bit */ \
+	OP(group, 0x40, bit(z80, z80->bc.hi, 0)) \
+	OP(group, 0x41, bit(z80, z80->bc.lo, 0)) \
+	OP(group, 0x42, bit(z80, z80->de.hi, 0)) \
+	OP(group, 0x43, bit(z80, z80->de.lo, 0)) \
+	OP(group, 0x44, bit(z80, z80->hl.hi, 0)) \
+	OP(group, 0x45, bit(z80, z80->hl.lo, 0)) \
+	OP(group, 0x46, bitMemHl(z80, 0)) \
+	OP(group, 0x47, bit(z80, z80->af.hi, 0)) \
+	OP(group, 0x48, bit(z80, z80->bc.hi, 1)) \
+	OP(group, 0x49, bit(z80, z80->bc.lo, 1)) \
+	OP(group, 0x4A, bit(z80, z80->de.hi, 1)) \
+	OP(group, 0x4B, bit(z80, z80->de.lo, 1)) \
+	OP(group, 0x4C, bit(z80, z80->hl.hi, 1)) \
+	OP(group, 0x4D, bit(z80, z80->hl.lo, 1)) \
+	OP(group, 0x4E, bitMemHl(z80, 1)) \
+	OP(group, 0x4F, bit(z80, z80->af.hi, 1)) \
+	OP(group, 0x50, bit(z80, z80->bc.hi, 2)) \
+	OP(group, 0x51, bit(z80, z80->bc.lo, 2)) \
+	OP(group, 0x52, bit(z80, z80->de.hi, 2)) \
+	OP(group, 0x53, bit(z80, z80->de.lo, 2)) \
+	OP(group, 0x54, bit(z80, z80->hl.hi, 2)) \
+	OP(group, 0x55, bit(z80, z80->hl.lo, 2)) \
+	OP(group, 0x56, bitMemHl(z80, 2)) \
+	OP(group, 0x57, bit(z80, z80->af.hi, 2)) \
+	OP(group, 0x58, bit(z80, z80->bc.hi, 3)) \
+	OP(group, 0x59, bit(z80, z80->bc.lo, 3)) \
+	OP(group, 0x5A, bit(z80, z80->de.hi, 3)) \
+	OP(group, 0x5B, bit(z80, z80->de.lo, 3)) \
+	OP(group, 0x5C, bit(z80, z80->hl.hi, 3)) \
+	OP(group, 0x5D, bit(z80, z80->hl.lo, 3)) \
+	OP(group, 0x5E, bitMemHl(z80, 3)) \
+	OP(group, 0x5F, bit(z80, z80->af.hi, 3)) \
+	OP(group, 0x60, bit(z80, z80->bc.hi, 4)) \
+	OP(group, 0x61, bit(z80, z80->bc.lo, 4)) \
+	OP(group, 0x62, bit(z80, z80->de.hi, 4)) \
+	OP(group, 0x63, bit(z80, z80->de.lo, 4)) \
+	OP(group, 0x64, bit(z80, z80->hl.hi, 4)) \
+	OP(group, 0x65, bit(z80, z80->hl.lo, 4)) \
+	OP(group, 0x66, bitMemHl(z80, 4)) \
+	OP(group, 0x67, bit(z80, z80->af.hi, 4)) \
+	OP(group, 0x68, bit(z80, z80->bc.hi, 5)) \
+	OP(group, 0x69, bit(z80, z80->bc.lo, 5)) \
+	OP(group, 0x6A, bit(z80, z80->de.hi, 5)) \
+	OP(group, 0x6B, bit(z80, z80->de.lo, 5)) \
+	OP(group, 0x6C, bit(z80, z80->hl.hi, 5)) \
+	OP(group, 0x6D, bit(z80, z80->hl.lo, 5)) \
+	OP(group, 0x6E, bitMemHl(z80, 5)) \
+	OP(group, 0x6F, bit(z80, z80->af.hi, 5)) \
+	OP(group, 0x70, bit(z80, z80->bc.hi, 6)) \
+	OP(group, 0x71, bit(z80, z80->bc.lo, 6)) \
+	OP(group, 0x72, bit(z80, z80->de.hi, 6)) \
+	OP(group, 0x73, bit(z80, z80->de.lo, 6)) \
+	OP(group, 0x74, bit(z80, z80->hl.hi, 6)) \
+	OP(group, 0x75, bit(z80, z80->hl.lo, 6)) \
+	OP(group, 0x76, bitMemHl(z80, 6)) \
+	OP(group, 0x77, bit(z80, z80->af.hi, 6)) \
+	OP(group, 0x78, bit(z80, z80->bc.hi, 7)) \
+	OP(group, 0x79, bit(z80, z80->bc.lo, 7)) \
+	OP(group, 0x7A, bit(z80, z80->de.hi, 7)) \
+	OP(group, 0x7B, bit(z80, z80->de.lo, 7)) \
+	OP(group, 0x7C, bit(z80, z80->hl.hi, 7)) \
+	OP(group, 0x7D, bit(z80, z80->hl.lo, 7)) \
+	OP(group, 0x7E, bitMemHl(z80, 7)) \
+	OP(group, 0x7F, bit(z80, z80->af.hi, 7)) \
+	OP(group, 0x80, res(z80, &z80->bc.hi, 0)) \
+	OP(group, 0x81, res(z80, &z80->bc.lo, 0)) \
+	OP(group, 0x82, res(z80, &z80->de.hi, 0)) \
+	OP(group, 0x83, res(z80, &z80->de.lo, 0)) \
+	OP(group, 0x84, res(z80, &z80->hl.hi, 0)) \
+	OP(group, 0x85, res(z80, &z80->hl.lo, 0)) \
+	OP(group, 0x86, resMemHl(z80, 0)) \
+	OP(group, 0x87, res(z80, &z80->af.hi, 0)) \
+	OP(group, 0x88, res(z80, &z80->bc.hi, 1)) \
+	OP(group, 0x89, res(z80, &z80->bc.lo, 1)) \
+	OP(group, 0x8A, res(z80, &z80->de.hi, 1)) \
+	OP(group, 0x8B, res(z80, &z80->de.lo, 1)) \
+	OP(group, 0x8C, res(z80, &z80->hl.hi, 1)) \
+	OP(group, 0x8D, res(z80, &z80->hl.lo, 1)) \
+	OP(group, 0x8E, resMemHl(z80, 1)) \
+	OP(group, 0x8F, res(z80, &z80->af.hi, 1)) \
+	OP(group, 0x90, res(z80, &z80->bc.hi, 2)) \
+	OP(group, 0x91, res(z80, &z80->bc.lo, 2)) \
+	OP(group, 0x92, res(z80, &z80->de.hi, 2)) \
+	OP(group, 0x93, res(z80, &z80->de.lo, 2)) \
+	OP(group, 0x94, res(z80, &z80->hl.hi, 2)) \
+	OP(group, 0x95, res(z80, &z80->hl.lo, 2)) \
+	OP(group, 0x96, resMemHl(z80, 2)) \
+	OP(group, 0x97, res(z80, &z80->af.hi, 2)) \
+	OP(group, 0x98, res(z80, &z80->bc.hi, 3)) \
+	OP(group, 0x99, res(z80, &z80->bc.lo, 3)) \
+	OP(group, 0x9A, res(z80, &z80->de.hi, 3)) \
+	OP(group, 0x9B, res(z80, &z80->de.lo, 3)) \
+	OP(group, 0x9C, res(z80, &z80->hl.hi, 3)) \
+	OP(group, 0x9D, res(z80, &z80->hl.lo, 3)) \
+	OP(group, 0x9E, resMemHl(z80, 3)) \
+	OP(group, 0x9F, res(z80, &z80->af.hi, 3)) \
+	OP(group, 0xA0, res(z80, &z80->bc.hi, 4)) \
+	OP(group, 0xA1, res(z80, &z80->bc.lo, 4)) \
+	OP(group, 0xA2, res(z80, &z80->de.hi, 4)) \
+	OP(group, 0xA3, res(z80, &z80->de.lo, 4)) \
+	OP(group, 0xA4, res(z80, &z80->hl.hi, 4)) \
+	OP(group, 0xA5, res(z80, &z80->hl.lo, 4)) \
+	OP(group, 0xA6, resMemHl(z80, 4)) \
+	OP(group, 0xA7, res(z80, &z80->af.hi, 4)) \
+	OP(group, 0xA8, res(z80, &z80->bc.hi, 5)) \
+	OP(group, 0xA9, res(z80, &z80->bc.lo, 5)) \
+	OP(group, 0xAA, res(z80, &z80->de.hi, 5)) \
+	OP(group, 0xAB, res(z80, &z80->de.lo, 5)) \
+	OP(group, 0xAC, res(z80, &z80->hl.hi, 5)) \
+	OP(group, 0xAD, res(z80, &z80->hl.lo, 5)) \
+	OP(group, 0xAE, resMemHl(z80, 5)) \
+	OP(group, 0xAF, res(z80, &z80->af.hi, 5)) \
+	OP(group, 0xB0, res(z80, &z80->bc.hi, 6)) \
+	OP(group, 0xB1, res(z80, &z80->bc.lo, 6)) \
+	OP(group, 0xB2, res(z80, &z80->de.hi, 6)) \
+	OP(group, 0xB3, res(z80, &z80->de.lo, 6)) \
+	OP(group, 0xB4, res(z80, &z80->hl.hi, 6)) \
+	OP(group, 0xB5, res(z80, &z80->hl.lo, 6)) \
+	OP(group, 0xB6, resMemHl(z80, 6)) \
+	OP(group, 0xB7, res(z80, &z80->af.hi, 6)) \
+	OP(group, 0xB8, res(z80, &z80->bc.hi, 7)) \
+	OP(group, 0xB9, res(z80, &z80->bc.lo, 7)) \
+	OP(group, 0xBA, res(z80, &z80->de.hi, 7)) \
+	OP(group, 0xBB, res(z80, &z80->de.lo, 7)) \
+	OP(group, 0xBC, res(z80, &z80->hl.hi, 7)) \
+	OP(group, 0xBD, res(z80, &z80->hl.lo, 7)) \
+	OP(group, 0xBE, resMemHl(z80, 7)) \
+	OP(group, 0xBF, res(z80, &z80->af.hi, 7)) \
+	OP(group, 0xC0, set(z80, &z80->bc.hi, 0)) \
+	OP(group, 0xC1, set(z80, &z80->bc.lo, 0)) \
+	OP(group, 0xC2, set(z80, &z80->de.hi, 0)) \
+	OP(group, 0xC3, set(z80, &z80->de.lo, 0)) \
+	OP(group, 0xC4, set(z80, &z80->hl.hi, 0)) \
+	OP(group, 0xC5, set(z80, &z80->hl.lo, 0)) \
+	OP(group, 0xC6, setMemHl(z80, 0)) \
+	OP(group, 0xC7, set(z80, &z80->af.hi, 0)) \
+	OP(group, 0xC8, set(z80, &z80->bc.hi, 1)) \
+	OP(group, 0xC9, set(z80, &z80->bc.lo, 1)) \
+	OP(group, 0xCA, set(z80, &z80->de.hi, 1)) \
+	OP(group, 0xCB, set(z80, &z80->de.lo, 1)) \
+	OP(group, 0xCC, set(z80, &z80->hl.hi, 1)) \
+	OP(group, 0xCD, set(z80, &z80->hl.lo, 1)) \
+	OP(group, 0xCE, setMemHl(z80, 1)) \
+	OP(group, 0xCF, set(z80, &z80->af.hi, 1)) \
+	OP(group, 0xD0, set(z80, &z80->bc.hi, 2)) \
+	OP(group, 0xD1, set(z80, &z80->bc.lo, 2)) \
+	OP(group, 0xD2, set(z80, &z80->de.hi, 2)) \
+	OP(group, 0xD3, set(z80, &z80->de.lo, 2)) \
+	OP(group, 0xD4, set(z80, &z80->hl.hi, 2)) \
+	OP(group, 0xD5, set(z80, &z80->hl.lo, 2)) \
+	OP(group, 0xD6, setMemHl(z80, 2)) \
+	OP(group, 0xD7, set(z80, &z80->af.hi, 2)) \
+	OP(group, 0xD8, set(z80, &z80->bc.hi, 3)) \
+	OP(group, 0xD9, set(z80, &z80->bc.lo, 3)) \
+	OP(group, 0xDA, set(z80, &z80->de.hi, 3)) \
+	OP(group, 0xDB, set(z80, &z80->de.lo, 3)) \
+	OP(group, 0xDC, set(z80, &z80->hl.hi, 3)) \
+	OP(group, 0xDD, set(z80, &z80->hl.lo, 3)) \
+	OP(group, 0xDE, setMemHl(z80, 3)) \
+	OP(group, 0xDF, set(z80, &z80->af.hi, 3)) \
+	OP(group, 0xE0, set(z80, &z80->bc.hi, 4)) \
+	OP(group, 0xE1, set(z80, &z80->bc.lo, 4)) \
+	OP(group, 0xE2, set(z80, &z80->de.hi, 4)) \
+	OP(group, 0xE3, set(z80, &z80->de.lo, 4)) \
+	OP(group, 0xE4, set(z80, &z80->hl.hi, 4)) \
+	OP(group, 0xE5, set(z80, &z80->hl.lo, 4)) \
+	OP(group, 0xE6, setMemHl(z80, 4)) \
+	OP(group, 0xE7, set(z80, &z80->af.hi, 4)) \
+	OP(group, 0xE8, set(z80, &z80->bc.hi, 5)) \
+	OP(group, 0xE9, set(z80, &z80->bc.lo, 5)) \
+	OP(group, 0xEA, set(z80, &z80->de.hi, 5)) \
+	OP(group, 0xEB, set(z80, &z80->de.lo, 5)) \
+	OP(group, 0xEC, set(z80, &z80->hl.hi, 5)) \
+	OP(group, 0xED, set(z80, &z80->hl.lo, 5)) \
+	OP(group, 0xEE, setMemHl(z80, 5)) \
+	OP(group, 0xEF, set(z80, &z80->af.hi, 5)) \
+	OP(group, 0xF0, set(z80, &z80->bc.hi, 6)) \
+	OP(group, 0xF1, set(z80, &z80->bc.lo, 6)) \
+	OP(group, 0xF2, set(z80, &z80->de.hi, 6)) \
+	OP(group, 0xF3, set(z80, &z80->de.lo, 6)) \
+	OP(group, 0xF4, set(z80, &z80->hl.hi, 6)) \
+	OP(group, 0xF5, set(z80, &z80->hl.lo, 6)) \
+	OP(group, 0xF6, setMemHl(z80, 6)) \
+	OP(group, 0xF7, set(z80, &z80->af.hi, 6)) \
+	OP(group, 0xF8, set(z80, &z80->bc.hi, 7)) \
+	OP(group, 0xF9, set(z80, &z80->bc.lo, 7)) \
+	OP(group, 0xFA, set(z80, &z80->de.hi, 7)) \
+	OP(group, 0xFB, set(z80, &z80->de.lo, 7)) \
+	OP(group, 0xFC, set(z80, &z80->hl.hi, 7)) \
+	OP(group, 0xFD, set(z80, &z80->hl.lo, 7)) \
+	OP(group, 0xFE, setMemHl(z80, 7)) \
+	OP(group, 0xFF, set(z80, &z80->af.hi, 7))
+
+#define Z80_IX_OPCODES(OP, group) \
+	/* the opcode is the last byte in the instruction and the */ \
+	/* displacement byte before it is fetched by the handler */ \
+	OP(group, 0xCB, Z80_DISPATCH(IxBit, z80ReadU8(z80, z80->pc + 1))) \
+	/* Loads */ \
+	OP(group, 0x22, loadMemReg16(z80, &z80->ix); z80->cycles += 4) \
+	OP(group, 0x2A, load16Reg(z80, &z80->ix); z80->cycles += 4) \
+	OP(group, 0x26, loadReg8(z80, &z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x2E, loadReg8(z80, &z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x40, loadReg(z80, &z80->bc.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x41, loadReg(z80, &z80->bc.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x42, loadReg(z80, &z80->bc.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x43, loadReg(z80, &z80->bc.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x47, loadReg(z80, &z80->bc.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x48, loadReg(z80, &z80->bc.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x49, loadReg(z80, &z80->bc.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x4A, loadReg(z80, &z80->bc.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x4B, loadReg(z80, &z80->bc.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x4F, loadReg(z80, &z80->bc.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x50, loadReg(z80, &z80->de.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x51, loadReg(z80, &z80->de.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x52, loadReg(z80, &z80->de.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x53, loadReg(z80, &z80->de.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x57, loadReg(z80, &z80->de.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x58, loadReg(z80, &z80->de.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x59, loadReg(z80, &z80->de.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x5A, loadReg(z80, &z80->de.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x5B, loadReg(z80, &z80->de.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x5F, loadReg(z80, &z80->de.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x78, loadAReg(z80, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x79, loadAReg(z80, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x7A, loadAReg(z80, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x7B, loadAReg(z80, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x7F, loadAReg(z80, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x44, loadReg(z80, &z80->bc.hi, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x45, loadReg(z80, &z80->bc.hi, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x4C, loadReg(z80, &z80->bc.lo, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x4D, loadReg(z80, &z80->bc.lo, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x54, loadReg(z80, &z80->de.hi, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x55, loadReg(z80, &z80->de.hi, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x5C, loadReg(z80, &z80->de.lo, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x5D, loadReg(z80, &z80->de.lo, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x60, loadReg(z80, &z80->ix.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x61, loadReg(z80, &z80->ix.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x62, loadReg(z80, &z80->ix.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x63, loadReg(z80, &z80->ix.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x64, loadReg(z80, &z80->ix.hi, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x65, loadReg(z80, &z80->ix.hi, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x67, loadReg(z80, &z80->ix.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x68, loadReg(z80, &z80->ix.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x69, loadReg(z80, &z80->ix.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x6A, loadReg(z80, &z80->ix.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x6B, loadReg(z80, &z80->ix.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x6C, loadReg(z80, &z80->ix.lo, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x6D, loadReg(z80, &z80->ix.lo, z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x6F, loadReg(z80, &z80->ix.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x7C, loadReg(z80, &z80->af.hi, z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x7D, loadReg(z80, &z80->af.hi, z80->ix.lo); z80->cycles += 4) \
+	/* Load value from ix + offset into reg8 */ \
+	OP(group, 0x46, loadRegIx(z80, &z80->bc.hi)) \
+	OP(group, 0x4E, loadRegIx(z80, &z80->bc.lo)) \
+	OP(group, 0x56, loadRegIx(z80, &z80->de.hi)) \
+	OP(group, 0x5E, loadRegIx(z80, &z80->de.lo)) \
+	OP(group, 0x66, loadRegIx(z80, &z80->hl.hi)) \
+	OP(group, 0x6E, loadRegIx(z80, &z80->hl.lo)) \
+	OP(group, 0x7E, loadRegIx(z80, &z80->af.hi)) \
+	/* Load reg8 into memory location ix + immediate s8 */ \
+	OP(group, 0x36, loadIxImm(z80)) \
+	OP(group, 0x70, loadIxReg(z80, z80->bc.hi)) \
+	OP(group, 0x71, loadIxReg(z80, z80->bc.lo)) \
+	OP(group, 0x72, loadIxReg(z80, z80->de.hi)) \
+	OP(group, 0x73, loadIxReg(z80, z80->de.lo)) \
+	OP(group, 0x74, loadIxReg(z80, z80->hl.hi)) \
+	OP(group, 0x75, loadIxReg(z80, z80->hl.lo)) \
+	OP(group, 0x77, loadIxReg(z80, z80->af.hi)) \
+	OP(group, 0xF9, loadSpReg(z80, &z80->ix)) \
+	/* Arithmetic */ \
+	OP(group, 0x09, addReg16(z80, &z80->ix, &z80->bc)) \
+	OP(group, 0x19, addReg16(z80, &z80->ix, &z80->de)) \
+	OP(group, 0x29, addReg16(z80, &z80->ix, &z80->ix)) \
+	OP(group, 0x39, addReg16(z80, &z80->ix, &z80->sp)) \
+	OP(group, 0x23, incReg16(z80, &z80->ix); z80->cycles += 4) \
+	OP(group, 0x24, incReg8(z80, &z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x2C, incReg8(z80, &z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x25, decReg8(z80, &z80->ix.hi); z80->cycles += 4) \
+	OP(group, 0x2D, decReg8(z80, &z80->ix.lo); z80->cycles += 4) \
+	OP(group, 0x2B, decReg16(z80, &z80->ix); z80->cycles += 4) \
+	OP(group, 0x34, incMemIx(z80)) \
+	OP(group, 0x35, decMemIx(z80)) \
+	OP(group, 0x84, addReg8(z80, &z80->af.hi, z80->ix.hi)) \
+	OP(group, 0x85, addReg8(z80, &z80->af.hi, z80->ix.lo)) \
+	OP(group, 0x86, addMemIx(z80, &z80->af.hi)) \
+	OP(group, 0x8C, adcReg8(z80, &z80->af.hi, z80->ix.hi)) \
+	OP(group, 0x8D, adcReg8(z80, &z80->af.hi, z80->ix.lo)) \
+	OP(group, 0x8E, adcMemIx(z80, &z80->af.hi)) \
+	OP(group, 0x94, subReg8(z80, &z80->af.hi, z80->ix.hi)) \
+	OP(group, 0x95, subReg8(z80, &z80->af.hi, z80->ix.lo)) \
+	OP(group, 0x96, subMemIx(z80, &z80->af.hi)) \
+	OP(group, 0x9C, sbcReg8(z80, &z80->af.hi, z80->ix.hi)) \
+	OP(group, 0x9D, sbcReg8(z80, &z80->af.hi, z80->ix.lo)) \
+	OP(group, 0x9E, sbcMemIx(z80, &z80->af.hi)) \
+	/* Logical */ \
+	OP(group, 0xA4, and(z80, z80->ix.hi)) \
+	OP(group, 0xA5, and(z80, z80->ix.lo)) \
+	OP(group, 0xA6, andMemIx(z80)) \
+	OP(group, 0xAC, xor(z80, z80->ix.hi)) \
+	OP(group, 0xAD, xor(z80, z80->ix.lo)) \
+	OP(group, 0xAE, xorMemIx(z80)) \
+	OP(group, 0xB4, or(z80, z80->ix.hi)) \
+	OP(group, 0xB5, or(z80, z80->ix.lo)) \
+	OP(group, 0xB6, orMemIx(z80)) \
+	OP(group, 0xBC, cp(z80, z80->ix.hi)) \
+	OP(group, 0xBD, cp(z80, z80->ix.lo)) \
+	OP(group, 0xBE, cpMemIx(z80)) \
+	OP(group, 0x21, loadReg16(z80, &z80->ix); z80->cycles += 4) \
+	OP(group, 0xE9, jpMemIx(z80)) \
+	OP(group, 0xE3, ex(z80, &z80->sp, &z80->ix)) \
+	OP(group, 0xE1, pop(z80, &z80->ix)) \
+	OP(group, 0xE5, push(z80, &z80->ix))
+
+#define Z80_IX_BIT_OPCODES(OP, group) \
+	OP(group, 0x06, rlcMemIx(z80)) \
+	OP(group, 0x0E, rrcMemIx(z80)) \
+	OP(group, 0x16, rlMemIx(z80)) \
+	OP(group, 0x1E, rrMemIx(z80)) \
+	OP(group, 0x26, slaMemIx(z80)) \
+	OP(group, 0x2E, sraMemIx(z80)) \
+	OP(group, 0x3E, srlMemIx(z80)) \
+	OP(group, 0x36, sllMemIx(z80)) \
+	OP(group, 0x46, bitMemIx(z80, 0)) \
+	OP(group, 0x4E, bitMemIx(z80, 1)) \
+	OP(group, 0x56, bitMemIx(z80, 2)) \
+	OP(group, 0x5E, bitMemIx(z80, 3)) \
+	OP(group, 0x66, bitMemIx(z80, 4)) \
+	OP(group, 0x6E, bitMemIx(z80, 5)) \
+	OP(group, 0x76, bitMemIx(z80, 6)) \
+	OP(group, 0x7E, bitMemIx(z80, 7)) \
+	OP(group, 0x86, resMemIx(z80, 0)) \
+	OP(group, 0x8E, resMemIx(z80, 1)) \
+	OP(group, 0x96, resMemIx(z80, 2)) \
+	OP(group, 0x9E, resMemIx(z80, 3)) \
+	OP(group, 0xA6, resMemIx(z80, 4)) \
+	OP(group, 0xAE, resMemIx(z80, 5)) \
+	OP(group, 0xB6, resMemIx(z80, 6)) \
+	OP(group, 0xBE, resMemIx(z80, 7)) \
+	OP(group, 0xC6, setMemIx(z80, 0)) \
+	OP(group, 0xCE, setMemIx(z80, 1)) \
+	OP(group, 0xD6, setMemIx(z80, 2)) \
+	OP(group, 0xDE, setMemIx(z80, 3)) \
+	OP(group, 0xE6, setMemIx(z80, 4)) \
+	OP(group, 0xEE, setMemIx(z80, 5)) \
+	OP(group, 0xF6, setMemIx(z80, 6)) \
+	OP(group, 0xFE, setMemIx(z80, 7))
+
+#define Z80_EXTENDED_OPCODES(OP, group) \
+	/* Loads */ \
+	OP(group, 0x43, loadMemReg16(z80, &z80->bc)) \
+	OP(group, 0x53, loadMemReg16(z80, &z80->de)) \
+	OP(group, 0x73, loadMemReg16(z80, &z80->sp)) \
+	OP(group, 0x57, loadAWithI(z80)) \
+	OP(group, 0x5F, loadAWithR(z80)) \
+	OP(group, 0x7B, load16Reg(z80, &z80->sp); z80->cycles += 4) \
+	OP(group, 0x4B, load16Reg(z80, &z80->bc); z80->cycles += 4) \
+	OP(group, 0x5B, load16Reg(z80, &z80->de); z80->cycles += 4) \
+	OP(group, 0x40, in(z80, z80->bc.lo, &z80->bc.hi, opcode)) \
+	OP(group, 0x48, in(z80, z80->bc.lo, &z80->bc.lo, opcode)) \
+	OP(group, 0x50, in(z80, z80->bc.lo, &z80->de.hi, opcode)) \
+	OP(group, 0x58, in(z80, z80->bc.lo, &z80->de.lo, opcode)) \
+	OP(group, 0x60, in(z80, z80->bc.lo, &z80->hl.hi, opcode)) \
+	OP(group, 0x68, in(z80, z80->bc.lo, &z80->hl.lo, opcode)) \
+	OP(group, 0x70, in(z80, z80->bc.lo, NULL, opcode)) \
+	OP(group, 0x78, in(z80, z80->bc.lo, &z80->af.hi, opcode)) \
+	OP(group, 0x41, out(z80, z80->bc.lo, z80->bc.hi)) \
+	OP(group, 0x49, out(z80, z80->bc.lo, z80->bc.lo)) \
+	OP(group, 0x51, out(z80, z80->bc.lo, z80->de.hi)) \
+	OP(group, 0x59, out(z80, z80->bc.lo, z80->de.lo)) \
+	OP(group, 0x61, out(z80, z80->bc.lo, z80->hl.hi)) \
+	OP(group, 0x69, out(z80, z80->bc.lo, z80->hl.lo)) \
+	OP(group, 0x71, out(z80, z80->bc.lo, 0)) \
+	OP(group, 0x79, out(z80, z80->bc.lo, z80->af.hi)) \
+	OP(group, 0x56, im(z80, One)) \
+	OP(group, 0x76, im(z80, One)) \
+	OP(group, 0xA1, cpi(z80)) \
+	OP(group, 0xB1, cpir(z80)) \
+	OP(group, 0xA9, cpd(z80)) \
+	OP(group, 0xB9, cpdr(z80)) \
+	OP(group, 0xA8, ldd(z80)) \
+	OP(group, 0xB8, lddr(z80)) \
+	OP(group, 0x67, rrd(z80)) \
+	OP(group, 0x6F, rld(z80)) \
+	/* Arithmetic */ \
+	OP(group, 0x42, sbcReg16(z80, &z80->hl, &z80->bc)) \
+	OP(group, 0x52, sbcReg16(z80, &z80->hl, &z80->de)) \
+	OP(group, 0x62, sbcReg16(z80, &z80->hl, &z80->hl)) \
+	OP(group, 0x72, sbcReg16(z80, &z80->hl, &z80->sp)) \
+	OP(group, 0x4A, adcReg16(z80, &z80->hl, &z80->bc)) \
+	OP(group, 0x5A, adcReg16(z80, &z80->hl, &z80->de)) \
+	OP(group, 0x6A, adcReg16(z80, &z80->hl, &z80->hl)) \
+	OP(group, 0x7A, adcReg16(z80, &z80->hl, &z80->sp)) \
+	/* Misc */ \
+	OP(group, 0x44, neg(z80)) \
+	/* Returns */ \
+	OP(group, 0x45, retn(z80)) \
+	OP(group, 0x4D, reti(z80)) \
+	OP(group, 0x55, retn(z80)) \
+	OP(group, 0x5D, retn(z80)) \
+	OP(group, 0x65, retn(z80)) \
+	OP(group, 0x6D, retn(z80)) \
+	OP(group, 0x75, retn(z80)) \
+	OP(group, 0x7D, retn(z80)) \
+	/* I/O instructions */ \
+	OP(group, 0xA0, ldi(z80)) \
+	OP(group, 0xA2, ini(z80)) \
+	OP(group, 0xA3, outi(z80)) \
+	OP(group, 0xAB, outd(z80)) \
+	OP(group, 0xB0, ldir(z80)) \
+	OP(group, 0xB2, inir(z80)) \
+	OP(group, 0xB3, otir(z80)) \
+	OP(group, 0xBB, otdr(z80))
+
+#define Z80_IY_OPCODES(OP, group) \
+	/* the opcode is the last byte in the instruction and the */ \
+	/* displacement byte before it is fetched by the handler */ \
+	OP(group, 0xCB, Z80_DISPATCH(IyBit, z80ReadU8(z80, z80->pc + 1))) \
+	/* Loads */ \
+	OP(group, 0x2A, load16Reg(z80, &z80->iy); z80->cycles += 4) \
+	OP(group, 0x22, loadMemReg16(z80, &z80->iy); z80->cycles += 4) \
+	OP(group, 0x26, loadReg8(z80, &z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x2E, loadReg8(z80, &z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x40, loadReg(z80, &z80->bc.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x41, loadReg(z80, &z80->bc.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x42, loadReg(z80, &z80->bc.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x43, loadReg(z80, &z80->bc.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x47, loadReg(z80, &z80->bc.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x48, loadReg(z80, &z80->bc.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x49, loadReg(z80, &z80->bc.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x4A, loadReg(z80, &z80->bc.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x4B, loadReg(z80, &z80->bc.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x4F, loadReg(z80, &z80->bc.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x50, loadReg(z80, &z80->de.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x51, loadReg(z80, &z80->de.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x52, loadReg(z80, &z80->de.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x53, loadReg(z80, &z80->de.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x57, loadReg(z80, &z80->de.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x58, loadReg(z80, &z80->de.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x59, loadReg(z80, &z80->de.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x5A, loadReg(z80, &z80->de.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x5B, loadReg(z80, &z80->de.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x5F, loadReg(z80, &z80->de.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x78, loadAReg(z80, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x79, loadAReg(z80, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x7A, loadAReg(z80, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x7B, loadAReg(z80, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x7F, loadAReg(z80, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x44, loadReg(z80, &z80->bc.hi, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x45, loadReg(z80, &z80->bc.hi, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x4C, loadReg(z80, &z80->bc.lo, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x4D, loadReg(z80, &z80->bc.lo, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x54, loadReg(z80, &z80->de.hi, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x55, loadReg(z80, &z80->de.hi, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x5C, loadReg(z80, &z80->de.lo, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x5D, loadReg(z80, &z80->de.lo, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x60, loadReg(z80, &z80->iy.hi, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x61, loadReg(z80, &z80->iy.hi, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x62, loadReg(z80, &z80->iy.hi, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x63, loadReg(z80, &z80->iy.hi, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x64, loadReg(z80, &z80->iy.hi, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x65, loadReg(z80, &z80->iy.hi, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x67, loadReg(z80, &z80->iy.hi, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x68, loadReg(z80, &z80->iy.lo, z80->bc.hi); z80->cycles += 4) \
+	OP(group, 0x69, loadReg(z80, &z80->iy.lo, z80->bc.lo); z80->cycles += 4) \
+	OP(group, 0x6A, loadReg(z80, &z80->iy.lo, z80->de.hi); z80->cycles += 4) \
+	OP(group, 0x6B, loadReg(z80, &z80->iy.lo, z80->de.lo); z80->cycles += 4) \
+	OP(group, 0x6C, loadReg(z80, &z80->iy.lo, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x6D, loadReg(z80, &z80->iy.lo, z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x6F, loadReg(z80, &z80->iy.lo, z80->af.hi); z80->cycles += 4) \
+	OP(group, 0x7C, loadReg(z80, &z80->af.hi, z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x7D, loadReg(z80, &z80->af.hi, z80->iy.lo); z80->cycles += 4) \
+	/* Load value from ix + offset into reg8 */ \
+	OP(group, 0x46, loadRegIy(z80, &z80->bc.hi)) \
+	OP(group, 0x4E, loadRegIy(z80, &z80->bc.lo)) \
+	OP(group, 0x56, loadRegIy(z80, &z80->de.hi)) \
+	OP(group, 0x5E, loadRegIy(z80, &z80->de.lo)) \
+	OP(group, 0x66, loadRegIy(z80, &z80->hl.hi)) \
+	OP(group, 0x6E, loadRegIy(z80, &z80->hl.lo)) \
+	OP(group, 0x7E, loadRegIy(z80, &z80->af.hi)) \
+	/* Load reg8 into memory location ix + immediate s8 */ \
+	OP(group, 0x36, loadIyImm(z80)) \
+	OP(group, 0x70, loadIyReg(z80, z80->bc.hi)) \
+	OP(group, 0x71, loadIyReg(z80, z80->bc.lo)) \
+	OP(group, 0x72, loadIyReg(z80, z80->de.hi)) \
+	OP(group, 0x73, loadIyReg(z80, z80->de.lo)) \
+	OP(group, 0x74, loadIyReg(z80, z80->hl.hi)) \
+	OP(group, 0x75, loadIyReg(z80, z80->hl.lo)) \
+	OP(group, 0x77, loadIyReg(z80, z80->af.hi)) \
+	OP(group, 0xF9, loadSpReg(z80, &z80->iy)) \
+	/* Arithmetic */ \
+	OP(group, 0x09, addReg16(z80, &z80->iy, &z80->bc)) \
+	OP(group, 0x19, addReg16(z80, &z80->iy, &z80->de)) \
+	OP(group, 0x29, addReg16(z80, &z80->iy, &z80->iy)) \
+	OP(group, 0x39, addReg16(z80, &z80->iy, &z80->sp)) \
+	OP(group, 0x21, loadReg16(z80, &z80->iy); z80->cycles += 4) \
+	OP(group, 0x23, incReg16(z80, &z80->iy); z80->cycles += 4) \
+	OP(group, 0x2B, decReg16(z80, &z80->iy); z80->cycles += 4) \
+	OP(group, 0x24, incReg8(z80, &z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x2C, incReg8(z80, &z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x25, decReg8(z80, &z80->iy.hi); z80->cycles += 4) \
+	OP(group, 0x2D, decReg8(z80, &z80->iy.lo); z80->cycles += 4) \
+	OP(group, 0x34, incMemIy(z80)) \
+	OP(group, 0x35, decMemIy(z80)) \
+	OP(group, 0x84, addReg8(z80, &z80->af.hi, z80->iy.hi)) \
+	OP(group, 0x85, addReg8(z80, &z80->af.hi, z80->iy.lo)) \
+	OP(group, 0x86, addMemIy(z80, &z80->af.hi)) \
+	OP(group, 0x8C, adcReg8(z80, &z80->af.hi, z80->iy.hi)) \
+	OP(group, 0x8D, adcReg8(z80, &z80->af.hi, z80->iy.lo)) \
+	OP(group, 0x8E, adcMemIy(z80, &z80->af.hi)) \
+	OP(group, 0x94, subReg8(z80, &z80->af.hi, z80->iy.hi)) \
+	OP(group, 0x95, subReg8(z80, &z80->af.hi, z80->iy.lo)) \
+	OP(group, 0x96, subMemIy(z80, &z80->af.hi)) \
+	OP(group, 0x9C, sbcReg8(z80, &z80->af.hi, z80->iy.hi)) \
+	OP(group, 0x9D, sbcReg8(z80, &z80->af.hi, z80->iy.lo)) \
+	OP(group, 0x9E, sbcMemIy(z80, &z80->af.hi)) \
+	/* Logical */ \
+	OP(group, 0xA4, and(z80, z80->iy.hi)) \
+	OP(group, 0xA5, and(z80, z80->iy.lo)) \
+	OP(group, 0xA6, andMemIy(z80)) \
+	OP(group, 0xAC, xor(z80, z80->iy.hi)) \
+	OP(group, 0xAD, xor(z80, z80->iy.lo)) \
+	OP(group, 0xAE, xorMemIy(z80)) \
+	OP(group, 0xB4, or(z80, z80->iy.hi)) \
+	OP(group, 0xB5, or(z80, z80->iy.lo)) \
+	OP(group, 0xB6, orMemIy(z80)) \
+	OP(group, 0xBC, cp(z80, z80->iy.hi)) \
+	OP(group, 0xBD, cp(z80, z80->iy.lo)) \
+	OP(group, 0xBE, cpMemIy(z80)) \
+	OP(group, 0xE9, jpMemIy(z80)) \
+	OP(group, 0xE3, ex(z80, &z80->sp, &z80->iy)) \
+	OP(group, 0xE1, pop(z80, &z80->iy)) \
+	OP(group, 0xE5, push(z80, &z80->iy))
+
+#define Z80_IY_BIT_OPCODES(OP, group) \
+	OP(group, 0x06, rlcMemIy(z80)) \
+	OP(group, 0x0E, rrcMemIy(z80)) \
+	OP(group, 0x16, rlMemIy(z80)) \
+	OP(group, 0x1E, rrMemIy(z80)) \
+	OP(group, 0x26, slaMemIy(z80)) \
+	OP(group, 0x2E, sraMemIy(z80)) \
+	OP(group, 0x3E, srlMemIy(z80)) \
+	OP(group, 0x36, sllMemIy(z80)) \
+	OP(group, 0x46, bitMemIy(z80, 0)) \
+	OP(group, 0x4E, bitMemIy(z80, 1)) \
+	OP(group, 0x56, bitMemIy(z80, 2)) \
+	OP(group, 0x5E, bitMemIy(z80, 3)) \
+	OP(group, 0x66, bitMemIy(z80, 4)) \
+	OP(group, 0x6E, bitMemIy(z80, 5)) \
+	OP(group, 0x76, bitMemIy(z80, 6)) \
+	OP(group, 0x7E, bitMemIy(z80, 7)) \
+	OP(group, 0x86, resMemIy(z80, 0)) \
+	OP(group, 0x8E, resMemIy(z80, 1)) \
+	OP(group, 0x96, resMemIy(z80, 2)) \
+	OP(group, 0x9E, resMemIy(z80, 3)) \
+	OP(group, 0xA6, resMemIy(z80, 4)) \
+	OP(group, 0xAE, resMemIy(z80, 5)) \
+	OP(group, 0xB6, resMemIy(z80, 6)) \
+	OP(group, 0xBE, resMemIy(z80, 7)) \
+	OP(group, 0xC6, setMemIy(z80, 0)) \
+	OP(group, 0xCE, setMemIy(z80, 1)) \
+	OP(group, 0xD6, setMemIy(z80, 2)) \
+	OP(group, 0xDE, setMemIy(z80, 3)) \
+	OP(group, 0xE6, setMemIy(z80, 4)) \
+	OP(group, 0xEE, setMemIy(z80, 5)) \
+	OP(group, 0xF6, setMemIy(z80, 6)) \
+	OP(group, 0xFE, setMemIy(z80, 7))
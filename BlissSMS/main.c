@@ -3,9 +3,72 @@
 #include <stdint.h>
 #include "SFML\Graphics.h"
 #include "Core\System.h"
+#include "Core\VdpKernels.h"
+#include "Core\VdpWorker.h"
+#include "Core\Pacing.h"
 
 
 int main(int argc, char *argv[]) {
+	//time the vdp renderer kernels instead of running a game
+	if (argc > 1 && strcmp(argv[1], "--bench-vdp") == 0) {
+		vdpKernelsInit();
+		vdpKernelsBenchmark();
+		return 0;
+	}
+	//time the psg's step synthesis at each quality instead of running a game
+	if (argc > 1 && strcmp(argv[1], "--bench-psg") == 0) {
+		psgBenchmark();
+		return 0;
+	}
+
+	//render on a second thread, the emulation thread only works out the sprite flags
+	u8 threaded_vdp = 0;
+	//--frame-skip N M draws only M - N frames out of every M
+	u8 frame_skip = 0, frame_skip_period = 0;
+	u8 frame_stats = 0;
+	//--audio-latency MS sets how far sound runs behind the emulation
+	u8 audio = 1;
+	u32 audio_latency = AUDIO_DEFAULT_LATENCY_MS;
+	//--sync audio|vsync|timer picks what keeps the emulation at full speed
+	enum PacingMode pacing_mode = PaceAudio;
+	//--audio-quality linear|16|64 sets the taps in each band limited step
+	enum PsgQuality audio_quality = PsgQualityMedium;
+	for (s32 i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--threaded-vdp") == 0)
+			threaded_vdp = 1;
+		else if (strcmp(argv[i], "--frame-skip") == 0 && i + 2 < argc) {
+			frame_skip = atoi(argv[i + 1]);
+			frame_skip_period = atoi(argv[i + 2]);
+			i += 2;
+		}
+		else if (strcmp(argv[i], "--frame-stats") == 0)
+			frame_stats = 1;
+		else if (strcmp(argv[i], "--no-audio") == 0)
+			audio = 0;
+		else if (strcmp(argv[i], "--audio-latency") == 0 && i + 1 < argc) {
+			audio_latency = atoi(argv[i + 1]);
+			i++;
+		}
+		else if (strcmp(argv[i], "--audio-quality") == 0 && i + 1 < argc) {
+			if (strcmp(argv[i + 1], "linear") == 0)
+				audio_quality = PsgQualityLinear;
+			else if (strcmp(argv[i + 1], "64") == 0)
+				audio_quality = PsgQualityHigh;
+			else
+				audio_quality = PsgQualityMedium;
+			i++;
+		}
+		else if (strcmp(argv[i], "--sync") == 0 && i + 1 < argc) {
+			if (strcmp(argv[i + 1], "vsync") == 0)
+				pacing_mode = PaceVsync;
+			else if (strcmp(argv[i + 1], "timer") == 0)
+				pacing_mode = PaceTimer;
+			else
+				pacing_mode = PaceAudio;
+			i++;
+		}
+	}
+
 	sfVideoMode mode = { 512, 384, 32 };
 	sfRenderWindow* window = sfRenderWindow_create(mode, "BlissSMS", sfResize | sfClose, NULL);
 	if (!window) {
@@ -20,8 +83,15 @@ int main(int argc, char *argv[]) {
 
 	struct System sms;
 	systemInit(&sms);
+	if (threaded_vdp)
+		vdpWorkerStart(&sms.vdp);
+	vdpSetFrameSkip(&sms.vdp, frame_skip, frame_skip_period);
+	psgSetQuality(&sms.psg, audio_quality);
+	if (audio)
+		systemStartAudio(&sms, audio_latency);
 
-	sfRenderWindow_setFramerateLimit(window, 60);
+	struct Pacing pacing;
+	pacingInit(&pacing, pacing_mode, window, &sms);
 
 	u8 running = 1;
 	sfEvent ev;
@@ -34,6 +104,14 @@ int main(int argc, char *argv[]) {
 		}
 
 		systemRunEmulation(&sms);
+		u8 pacing_window = pacingEndFrame(&pacing, &sms);
+		if (frame_stats) {
+			vdpPrintFrameStats(&sms.vdp);
+			if (sms.audio.stream != NULL)
+				audioPrintStats(&sms.audio);
+			if (pacing_window)
+				pacingPrintStats(&pacing, &sms);
+		}
 
 		sfRenderWindow_clear(window, sfTransparent);
 
@@ -42,6 +120,7 @@ int main(int argc, char *argv[]) {
 		sfRenderWindow_display(window);
 	}
 
+	pacingFree(&pacing);
 	systemFree(&sms);
 
 	sfImage_destroy(img);